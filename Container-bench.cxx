@@ -0,0 +1,388 @@
+/// @file Container-bench.cxx
+/// @author Etienne Bravo
+///
+/// @brief Micro-benchmarks for the LList and Stack classes. Every operation
+/// is timed for char, int and std::string elements, with container sizes
+/// from 8 to the size given on the command line (10^6 by default, up to
+/// 10^7 and beyond if memory allows):
+///
+///   container_bench [max_size]
+///
+/// LList rows also cover splice (three splices per operation) and sort.
+/// Each row reports the time per operation, the node allocations per
+/// operation counted by alloc_track, and the peak resident set size of the
+/// row. Every row runs in a child process of its own, so its peak is not
+/// hidden by the larger rows before it. Backends for Stack and LList should
+/// be compared with these numbers before they are adopted.
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Stack.hpp"  // check include guard
+
+namespace {
+
+/// Minimum number of operations timed per row, small sizes are repeated.
+const std::size_t min_ops = 1000000;
+
+/// Keeps results alive so the compiler cannot drop the timed loops.
+volatile std::size_t sink;
+
+/// Makes the compiler assume the object is read and written here, so loops
+/// of moves and swaps that cancel out are not optimized away.
+inline void clobber(void* object) {
+    asm volatile("" : : "r"(object) : "memory");
+}
+
+template <class T> T make_value(std::size_t i);
+template <> char make_value<char>(std::size_t i) { return static_cast<char>('a' + i % 26); }
+template <> int  make_value<int>(std::size_t i) { return static_cast<int>(i); }
+template <> std::string make_value<std::string>(std::size_t i) {
+    return "token" + std::to_string(i % 1000);  // fits the small string buffer
+}
+
+template <class T> const char* type_name();
+template <> const char* type_name<char>() { return "char"; }
+template <> const char* type_name<int>() { return "int"; }
+template <> const char* type_name<std::string>() { return "string"; }
+
+std::size_t checksum(char value) { return static_cast<unsigned char>(value); }
+std::size_t checksum(int value) { return static_cast<std::size_t>(value); }
+std::size_t checksum(const std::string& value) { return value.size(); }
+
+/// @return Peak resident set size of the calling process in KiB.
+long peak_rss_kib() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/// Times one benchmark and prints its row, in a child process whose peak
+/// resident set size is the one of this row alone.
+///
+/// @param container Name of the container.
+/// @param type Name of the element type.
+/// @param op Name of the operation.
+/// @param size Number of elements in the container.
+/// @param body Runs one round and returns the number of operations done,
+/// taking a stopwatch it must start and stop around the timed part.
+template <class Body>
+void run(const char* container, const char* type, const char* op, std::size_t size, Body body) {
+    using clock = std::chrono::steady_clock;
+
+    // Only the allocations made while the watch runs are counted
+    struct Stopwatch {
+        clock::duration   elapsed{};
+        clock::time_point started;
+        std::size_t       allocations = 0;
+        std::size_t       allocations_at_start = 0;
+
+        void start() {
+            allocations_at_start = alloc_track::phase(alloc_track::OTHER).allocations;
+            started = clock::now();
+        }
+        void stop() {
+            elapsed += clock::now() - started;
+            allocations += alloc_track::phase(alloc_track::OTHER).allocations - allocations_at_start;
+        }
+    } watch;
+
+    // The parent never runs a benchmark, a child starts from its small heap
+    std::fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+
+    if (child == 0) {
+        std::size_t ops = 0;
+        while (ops < min_ops) {
+            ops += body(watch);
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(watch.elapsed).count();
+        std::printf("%-8s %-7s %-9s %9zu %10.2f %10.3f %10ld\n", container, type, op, size,
+                    ns / ops, static_cast<double>(watch.allocations) / ops, peak_rss_kib());
+        std::fflush(stdout);
+        _exit(0);
+    }
+
+    int status;
+    while (waitpid(child, &status, 0) < 0) {
+        if (errno != EINTR) {
+            std::perror("waitpid");
+            std::exit(1);
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        std::fprintf(stderr, "%s %s %s %zu: killed by signal %d\n", container, type, op, size,
+                     WTERMSIG(status));
+        std::exit(1);
+    }
+}
+
+template <class T>
+void bench_stack(std::size_t size) {
+    const char* type = type_name<T>();
+
+    run("Stack", type, "push", size, [&](auto& watch) {
+        Stack<T> stack;
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            stack.push(make_value<T>(i));
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("Stack", type, "top", size, [&](auto& watch) {
+        Stack<T> stack;
+        stack.push(make_value<T>(0));
+        std::size_t sum = 0;
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            sum += checksum(stack.top());
+        }
+        watch.stop();
+        sink = sum;
+        return size;
+    });
+
+    run("Stack", type, "pop", size, [&](auto& watch) {
+        Stack<T> stack;
+        for (std::size_t i = 0; i < size; ++i) {
+            stack.push(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            stack.pop();
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("Stack", type, "copy", size, [&](auto& watch) {
+        Stack<T> stack;
+        for (std::size_t i = 0; i < size; ++i) {
+            stack.push(make_value<T>(i));
+        }
+        watch.start();
+        Stack<T> copy(stack);
+        watch.stop();
+        sink = copy.size();
+        return size;
+    });
+
+    run("Stack", type, "move", size, [&](auto& watch) {
+        Stack<T> stack;
+        for (std::size_t i = 0; i < size; ++i) {
+            stack.push(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < min_ops; ++i) {
+            Stack<T> moved(std::move(stack));
+            clobber(&moved);
+            stack.swap(moved);
+        }
+        watch.stop();
+        sink = stack.size();
+        return min_ops;
+    });
+
+    run("Stack", type, "swap", size, [&](auto& watch) {
+        Stack<T> first, second;
+        for (std::size_t i = 0; i < size; ++i) {
+            first.push(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < min_ops; ++i) {
+            first.swap(second);
+            clobber(&first);
+        }
+        watch.stop();
+        sink = first.size();
+        return min_ops;
+    });
+}
+
+template <class T>
+void bench_llist(std::size_t size) {
+    const char* type = type_name<T>();
+
+    run("LList", type, "push", size, [&](auto& watch) {
+        LList<T> list;
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("LList", type, "pop", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            list.pop_front();
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("LList", type, "iterate", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        std::size_t sum = 0;
+        watch.start();
+        for (const T& value : list) {
+            sum += checksum(value);
+        }
+        watch.stop();
+        sink = sum;
+        return size;
+    });
+
+    run("LList", type, "copy", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        watch.start();
+        LList<T> copy(list);
+        watch.stop();
+        sink = copy.size();
+        return size;
+    });
+
+    run("LList", type, "move", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < min_ops; ++i) {
+            LList<T> moved(std::move(list));
+            clobber(&moved);
+            list = std::move(moved);
+        }
+        watch.stop();
+        sink = list.size();
+        return min_ops;
+    });
+
+    run("LList", type, "insert", size, [&](auto& watch) {
+        LList<T> list;
+        list.push_back(make_value<T>(0));
+        list.push_back(make_value<T>(1));
+        auto middle = ++list.begin();
+        watch.start();
+        for (std::size_t i = 0; i < size; ++i) {
+            list.insert(middle, make_value<T>(i));
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("LList", type, "erase", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i));
+        }
+        watch.start();
+        for (auto it = list.begin(); it != list.end();) {
+            it = list.erase(it);
+        }
+        watch.stop();
+        return size;
+    });
+
+    run("LList", type, "splice", size, [&](auto& watch) {
+        LList<T> first, second;
+        for (std::size_t i = 0; i < size; ++i) {
+            first.push_back(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < min_ops; ++i) {
+            second.splice(second.end(), first);
+            first.splice(first.begin(), second, second.begin(), ++second.begin());
+            first.splice(first.end(), second);
+            clobber(&first);
+        }
+        watch.stop();
+        sink = first.size();
+        return min_ops;
+    });
+
+    run("LList", type, "sort", size, [&](auto& watch) {
+        LList<T> list;
+        for (std::size_t i = 0; i < size; ++i) {
+            list.push_back(make_value<T>(i * 7919 % size));
+        }
+        watch.start();
+        list.sort();
+        watch.stop();
+        sink = list.size();
+        return size;
+    });
+
+    run("LList", type, "swap", size, [&](auto& watch) {
+        LList<T> first, second;
+        for (std::size_t i = 0; i < size; ++i) {
+            first.push_back(make_value<T>(i));
+        }
+        watch.start();
+        for (std::size_t i = 0; i < min_ops; ++i) {
+            first.swap(second);
+            clobber(&first);
+        }
+        watch.stop();
+        sink = first.size();
+        return min_ops;
+    });
+}
+
+template <class T>
+void bench_type(const std::vector<std::size_t>& sizes) {
+    for (std::size_t size : sizes) {
+        bench_stack<T>(size);
+        bench_llist<T>(size);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t max_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::vector<std::size_t> sizes;
+
+    for (std::size_t size = 8; size <= max_size; size = size == 8 ? 100 : size * 10) {
+        sizes.push_back(size);
+    }
+
+    alloc_track::enable();
+    std::printf("%-8s %-7s %-9s %9s %10s %10s %10s\n", "backend", "type", "op", "size",
+                "ns/op", "allocs/op", "peak KiB");
+
+    bench_type<char>(sizes);
+    bench_type<int>(sizes);
+    bench_type<std::string>(sizes);
+
+    return 0;
+}
+
+/* EOF */
@@ -0,0 +1,306 @@
+/// @file LList-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the bulk operations of the LList class: range
+/// insert and assign, splice, sort and reverse. They check the contents and
+/// size of the lists, both link directions, and that nodes are relinked
+/// instead of copied. Also tests that a reserved list reuses its nodes.
+
+#include <forward_list>
+#include <sstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "LList.hpp"  // check include guard
+#include "alloc_track.hpp"
+
+// Contents of a list, walked forward
+template <class T>
+std::vector<T> forward(const LList<T>& list) {
+    return std::vector<T>(list.begin(), list.end());
+}
+
+// Contents of a list, walked backward through the prev links
+template <class T>
+std::vector<T> backward(const LList<T>& list) {
+    std::vector<T> values;
+    if (!list.empty()) {
+        auto it = list.begin();
+        while (it.current->next != nullptr) {
+            ++it;
+        }
+        for (; it.current != nullptr; --it) {
+            values.push_back(*it);
+        }
+    }
+    return values;
+}
+
+// Checks contents, size and both link directions
+template <class T>
+void check_list(const LList<T>& list, const std::vector<T>& expected) {
+    CHECK(forward(list) == expected);
+    CHECK(backward(list) == std::vector<T>(expected.rbegin(), expected.rend()));
+    CHECK(list.size() == expected.size());
+}
+
+// Test range insert and assign
+TEST_CASE("range insert and assign", "[LList]") {
+    LList<int> list{1, 5};
+
+    SECTION("insert a forward range in the middle") {
+        std::vector<int> values{2, 3, 4};
+        auto it = list.insert(++list.begin(), values.begin(), values.end());
+        CHECK(*it == 2);
+        check_list(list, {1, 2, 3, 4, 5});
+    }
+
+    SECTION("insert at both ends") {
+        std::vector<int> values{8, 9};
+        list.insert(list.begin(), values.begin(), values.end());
+        list.insert(list.end(), values.begin(), values.end());
+        check_list(list, {8, 9, 1, 5, 8, 9});
+    }
+
+    SECTION("insert a single pass range") {
+        std::istringstream input("6 7");
+        list.insert(list.end(), std::istream_iterator<int>(input), std::istream_iterator<int>());
+        check_list(list, {1, 5, 6, 7});
+    }
+
+    SECTION("insert an empty range returns the position") {
+        std::vector<int> values;
+        auto it = list.insert(list.begin(), values.begin(), values.end());
+        CHECK(it == list.begin());
+        check_list(list, {1, 5});
+    }
+
+    SECTION("assign replaces the contents") {
+        std::forward_list<int> values{4, 3, 2};
+        list.assign(values.begin(), values.end());
+        check_list(list, {4, 3, 2});
+    }
+
+    SECTION("nodes of a block can be erased one by one") {
+        LList<std::string> words{"a", "b", "c", "d"};
+        words.erase(++words.begin());
+        words.pop_front();
+        words.pop_back();
+        check_list(words, {std::string("c")});
+    }
+
+    SECTION("copies are independent") {
+        LList<int> copy(list);
+        copy.push_back(9);
+        check_list(list, {1, 5});
+        check_list(copy, {1, 5, 9});
+    }
+}
+
+// Test splice
+TEST_CASE("splice", "[LList]") {
+    LList<int> list{1, 2, 3};
+    LList<int> other{7, 8, 9};
+
+    SECTION("whole list") {
+        int* moved = &other.front();
+        list.splice(++list.begin(), other);
+        check_list(list, {1, 7, 8, 9, 2, 3});
+        check_list(other, {});
+        CHECK(&*++list.begin() == moved);  // relinked, not copied
+    }
+
+    SECTION("whole list into an empty list") {
+        LList<int> empty;
+        empty.splice(empty.end(), other);
+        check_list(empty, {7, 8, 9});
+        CHECK(other.empty());
+    }
+
+    SECTION("single node from another list") {
+        list.splice(list.end(), other, ++other.begin());
+        check_list(list, {1, 2, 3, 8});
+        check_list(other, {7, 9});
+    }
+
+    SECTION("head and tail of another list, to both ends") {
+        LList<int> a{1, 2, 3};
+        LList<int> b{4, 5, 6};
+        a.splice(a.end(), b, std::next(b.begin(), 2));  // tail to end()
+        check_list(a, {1, 2, 3, 6});
+        check_list(b, {4, 5});
+        a.splice(a.begin(), b, ++b.begin());  // tail to begin()
+        check_list(a, {5, 1, 2, 3, 6});
+        check_list(b, {4});
+        a.splice(a.end(), b, b.begin());  // head and tail to end()
+        check_list(a, {5, 1, 2, 3, 6, 4});
+        check_list(b, {});
+        b.splice(b.begin(), a, a.begin());  // head to begin() of an empty list
+        check_list(a, {1, 2, 3, 6, 4});
+        check_list(b, {5});
+        a.splice(a.begin(), b, b.begin());  // head to begin()
+        check_list(a, {5, 1, 2, 3, 6, 4});
+        check_list(b, {});
+    }
+
+    SECTION("single node within the same list") {
+        list.splice(list.begin(), list, std::next(list.begin(), 2));
+        check_list(list, {3, 1, 2});
+        list.splice(list.begin(), list, list.begin());
+        check_list(list, {3, 1, 2});
+        list.splice(list.end(), list, std::next(list.begin(), 2));
+        check_list(list, {3, 1, 2});
+        list.splice(list.end(), list, list.begin());
+        check_list(list, {1, 2, 3});
+    }
+
+    SECTION("splicing end() throws") {
+        CHECK_THROWS_AS(list.splice(list.begin(), other, other.end()), std::invalid_argument);
+    }
+
+    SECTION("range from another list") {
+        list.splice(list.begin(), other, ++other.begin(), other.end());
+        check_list(list, {8, 9, 1, 2, 3});
+        check_list(other, {7});
+    }
+
+    SECTION("range within the same list") {
+        list.splice(list.end(), list, list.begin(), std::next(list.begin(), 2));
+        check_list(list, {3, 1, 2});
+    }
+}
+
+// Test sort and reverse
+TEST_CASE("sort and reverse", "[LList]") {
+    SECTION("sort orders the elements") {
+        LList<int> list{5, 3, 9, 1, 4, 1, 8, 2, 7};
+        list.sort();
+        check_list(list, {1, 1, 2, 3, 4, 5, 7, 8, 9});
+    }
+
+    SECTION("sort is stable") {
+        LList<std::pair<int, char>> list{{2, 'a'}, {1, 'b'}, {2, 'c'}, {1, 'd'}, {0, 'e'}};
+        list.sort([](const auto& a, const auto& b) { return a.first < b.first; });
+        check_list(list, {{0, 'e'}, {1, 'b'}, {1, 'd'}, {2, 'a'}, {2, 'c'}});
+    }
+
+    SECTION("sort keeps references valid") {
+        LList<int> list{3, 2, 1};
+        int* three = &list.front();
+        list.sort();
+        CHECK(&list.back() == three);
+    }
+
+    SECTION("sort large lists") {
+        LList<int> list;
+        std::vector<int> expected;
+        for (int i = 0; i < 1000; ++i) {
+            list.push_back((i * 7919) % 1000);
+            expected.push_back(i);
+        }
+        list.sort();
+        check_list(list, expected);
+        list.sort(std::greater<int>());
+        check_list(list, std::vector<int>(expected.rbegin(), expected.rend()));
+    }
+
+    SECTION("reverse") {
+        LList<int> list{1, 2, 3, 4};
+        list.reverse();
+        check_list(list, {4, 3, 2, 1});
+
+        LList<int> single{1};
+        single.reverse();
+        check_list(single, {1});
+    }
+}
+
+// Test reserve and the reuse of removed nodes
+TEST_CASE("reserve", "[LList]") {
+    SECTION("a list that is not reserved has no spare nodes") {
+        LList<int> list{1, 2, 3};
+        list.pop_back();
+        CHECK(list.capacity() == 2);
+    }
+
+    SECTION("reserve keeps the contents") {
+        LList<int> list{1, 2, 3};
+        list.reserve(10);
+        CHECK(list.capacity() == 10);
+        list.reserve(5);
+        CHECK(list.capacity() == 10);
+        check_list(list, {1, 2, 3});
+    }
+
+    SECTION("removed nodes are kept") {
+        LList<int> list;
+        list.reserve(4);
+        for (int i = 0; i < 6; ++i) {
+            list.push_back(i);
+        }
+        list.erase(std::next(list.begin()));
+        list.pop_front();
+        list.clear();
+        CHECK(list.empty());
+        CHECK(list.capacity() == 6);
+
+        list.push_front(2);
+        list.push_front(1);
+        list.insert(list.end(), 3);
+        check_list(list, {1, 2, 3});
+        CHECK(list.capacity() == 6);
+    }
+
+    SECTION("a reserved list does not allocate once warm") {
+        alloc_track::enable();
+        LList<std::string> list;
+        list.reserve(8);
+        alloc_track::Snapshot before = alloc_track::container<std::string>();
+        for (int round = 0; round < 100; ++round) {
+            for (int i = 0; i < 8; ++i) {
+                list.push_back("value");
+            }
+            list.clear();
+        }
+        alloc_track::Snapshot after = alloc_track::container<std::string>();
+        alloc_track::enable(false);
+        CHECK(after.allocations == before.allocations);
+        CHECK(after.frees == before.frees);
+    }
+
+    SECTION("shrink_to_fit frees the spare nodes") {
+        LList<int> list;
+        list.reserve(4);
+        list.push_back(1);
+        list.push_back(2);
+        list.pop_back();
+        list.shrink_to_fit();
+        CHECK(list.capacity() == 1);
+        list.pop_back();
+        CHECK(list.capacity() == 0);
+    }
+
+    SECTION("assignment keeps the spare nodes") {
+        LList<int> list;
+        list.reserve(4);
+        LList<int> other{7, 8};
+        list = other;
+        check_list(list, {7, 8});
+        CHECK(list.capacity() == 6);
+        CHECK(other.capacity() == 2);
+    }
+
+    SECTION("swap exchanges the spare nodes") {
+        LList<int> list;
+        list.reserve(4);
+        LList<int> other{7};
+        list.swap(other);
+        check_list(list, {7});
+        CHECK(list.capacity() == 1);
+        CHECK(other.capacity() == 4);
+    }
+}
@@ -13,7 +13,14 @@
 #include <cstddef>
 #include <iostream>
 #include <algorithm>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include "alloc_track.hpp"
+
+template <class T> struct NodeBlock;
 
 /// Node is a Struct that creates values with pointers to previous and
 /// following nodes (if any). Used by LList class to create linked lists that
@@ -25,12 +32,33 @@ struct Node {
 
     // Construct
     Node(const value_type& value, Node* prev_node = nullptr,
-                                  Node* next_node = nullptr)
-    : data(value), prev(prev_node), next(next_node) {}
+                                  Node* next_node = nullptr,
+                                  NodeBlock<T>* node_block = nullptr)
+    : data(value), prev(prev_node), next(next_node), block(node_block) {}
+
+    value_type    data;   ///< Data of the node, of type T
+    Node*         prev;   ///< Pointer to the previous node
+    Node*         next;   ///< Pointer to the next node
+    NodeBlock<T>* block;  ///< Block holding the node, nullptr if allocated alone
+};
+
+/// NodeBlock is the storage of the nodes created together by a range
+/// insert() or assign(). The nodes follow the block in the same allocation,
+/// which is freed when the last of them is destroyed. Nodes of a block can be
+/// spliced into other lists like any other node.
+
+template <class T>
+struct NodeBlock {
+    /// Offset of the first node from the start of the block.
+    static constexpr std::size_t offset =
+        (sizeof(std::size_t) + alignof(Node<T>) - 1) / alignof(Node<T>) * alignof(Node<T>);
+
+    /// @return The first node of the block.
+    Node<T>* nodes() {
+        return reinterpret_cast<Node<T>*>(reinterpret_cast<char*>(this) + offset);
+    }
 
-    value_type data;   ///< Data of the node, of type T
-    Node*      prev;   ///< Pointer to the previous node
-    Node*      next;   ///< Pointer to the next node
+    std::size_t live;  ///< Number of nodes of the block not destroyed yet
 };
 
 /// List is a container that supports constant time insertion and removal of
@@ -148,6 +176,20 @@ public:
     /// @return Number of elements in list
     size_type size() const noexcept { return count; }
 
+    /// Allocates spare nodes, in one block, until capacity() is at least n.
+    /// From then on the nodes of removed elements are kept as spares and
+    /// reused by push_front(), push_back() and insert() instead of being
+    /// freed, so capacity() only grows, like the capacity of a std::vector,
+    /// until shrink_to_fit(). clear() keeps the capacity too.
+    /// @param n Number of elements to allocate nodes for
+    void      reserve(size_type n);
+
+    /// @return Number of elements the list can hold without allocating
+    size_type capacity() const noexcept { return count + spare_count; }
+
+    /// Frees the spare nodes and stops keeping the nodes of removed elements.
+    void      shrink_to_fit() noexcept;
+
     // element access
     /// Returns a reference to the first element in the list.
     /// @note Calling empty list will throw an exemption
@@ -186,6 +228,26 @@ public:
     /// @param value Value to be appended
     iterator insert(const_iterator position, const T& value);
 
+    /// Inserts copies of the values of a range before the given position.
+    /// When the range can be walked twice (forward iterators), the nodes are
+    /// allocated in a single block.
+    /// @param position Position where the values will be inserted
+    /// @param first Beginning of the range
+    /// @param last End of the range
+    /// @return Iterator to the first inserted value, or position if the
+    /// range is empty
+    template <class InputIt,
+              class = typename std::iterator_traits<InputIt>::iterator_category>
+    iterator insert(const_iterator position, InputIt first, InputIt last);
+
+    /// Replaces the contents of the list with copies of the values of a range.
+    /// The nodes are allocated like in the range insert().
+    /// @param first Beginning of the range
+    /// @param last End of the range
+    template <class InputIt,
+              class = typename std::iterator_traits<InputIt>::iterator_category>
+    void     assign(InputIt first, InputIt last);
+
     /// deletes given value from given position
     /// @note Invalid Position will cause an exemption out_of_range
     /// @param position Position where value will be erased
@@ -198,10 +260,98 @@ public:
     /// Clears list, ready to be reused
     void     clear() noexcept;
 
+    // operations
+    /// Moves all the nodes of other before the given position, in constant
+    /// time. No element is copied and other is left empty.
+    /// @param position Position where the nodes will be inserted
+    /// @param other Another LList object
+    void     splice(const_iterator position, LList& other);
+
+    /// Moves one node of other, which may be this list, before the given
+    /// position, in constant time.
+    /// @note Splicing end() throws invalid_argument
+    /// @param position Position where the node will be inserted
+    /// @param other The list holding the node
+    /// @param it The node to move
+    void     splice(const_iterator position, LList& other, const_iterator it);
+
+    /// Moves the nodes [first, last) of other before the given position. The
+    /// nodes are relinked in constant time, but counting them for size() is
+    /// linear in the length of the range when other is another list.
+    /// @note position must not be inside the range
+    /// @param position Position where the nodes will be inserted
+    /// @param other The list holding the nodes
+    /// @param first First node to move
+    /// @param last One past the last node to move
+    void     splice(const_iterator position, LList& other, const_iterator first,
+                    const_iterator last);
+
+    /// Sorts the list in ascending order with a stable merge sort. Nodes are
+    /// relinked, elements are never copied or moved, so iterators and
+    /// references stay valid.
+    void     sort();
+
+    /// Sorts the list with a stable merge sort, see sort().
+    /// @param comp Returns true if its first argument goes before the second
+    template <class Compare>
+    void     sort(Compare comp);
+
+    /// Reverses the order of the elements by relinking the nodes.
+    void     reverse() noexcept;
+
 private:
-    Node<T>*  head;
-    Node<T>*  tail;
-    size_type count;
+    /// Creates n linked nodes holding copies of the values starting at
+    /// first, allocated in one block. Counted by alloc_track when tracking is
+    /// enabled.
+    /// @return The first node, the others follow it in memory.
+    template <class ForwardIt>
+    static Node<T>* create_nodes(ForwardIt first, size_type n);
+
+    /// Links the chain of nodes [first, last] before position, nullptr
+    /// meaning the end of the list. The count is not updated.
+    void     link(Node<T>* position, Node<T>* first, Node<T>* last) noexcept;
+
+    /// Unlinks the chain of nodes [first, last] from the list. The count is
+    /// not updated.
+    void     unlink(Node<T>* first, Node<T>* last) noexcept;
+
+    /// Allocates a node. Counted by alloc_track when tracking is enabled.
+    /// @return The new node.
+    static Node<T>* create_node(const T& value, Node<T>* prev, Node<T>* next);
+
+    /// Frees a node allocated by create_node() or create_nodes().
+    /// @param node The node to free.
+    static void     destroy_node(Node<T>* node);
+
+    /// The storage of a spare node. It is written over the node once the
+    /// node is destroyed, nodes are always large enough to hold it.
+    struct SpareLink {
+        SpareLink*    next;
+        NodeBlock<T>* block;  ///< Block holding the storage, nullptr if allocated alone
+    };
+
+    /// Takes a spare node for value, or allocates one if there is none.
+    /// @return The new node.
+    Node<T>* acquire_node(const T& value, Node<T>* prev, Node<T>* next);
+
+    /// Destroys the element of a removed node. The node is kept as a spare
+    /// after reserve(), freed otherwise.
+    /// @param node The node to release.
+    void     release_node(Node<T>* node) noexcept;
+
+    /// Frees the storage of a spare node.
+    /// @param link The spare node to free.
+    static void free_spare(SpareLink* link) noexcept;
+
+    /// Swaps the elements with other, each list keeps its spare nodes.
+    void     swap_nodes(LList& other) noexcept;
+
+    Node<T>*   head;
+    Node<T>*   tail;
+    size_type  count;
+    SpareLink* spare       = nullptr;  ///< Nodes kept for reuse
+    size_type  spare_count = 0;        ///< Number of spare nodes
+    bool       retain      = false;    ///< Keep the nodes of removed elements
 };
 
 ///----------------------------------------------------------------------------
@@ -271,9 +421,7 @@ bool LList<T>::BiDirectionalIterator::operator!=(const BiDirectionalIterator&
 // COPY CONSTRUCTOR
 template <class T>
 LList<T>::LList(const LList& other) : LList<T>() {
-    for (const auto& item : other) {
-        push_back(item);
-    }
+    insert(end(), other.begin(), other.end());
 }
 
 // MOVE CONSTRUCTOR
@@ -282,14 +430,15 @@ LList<T>::LList(LList&& other) {
     head = std::exchange(other.head, nullptr);
     tail = std::exchange(other.tail, nullptr);
     count = std::exchange(other.count, 0);
+    spare = std::exchange(other.spare, nullptr);
+    spare_count = std::exchange(other.spare_count, 0);
+    retain = std::exchange(other.retain, false);
 }
 
 // INITIALIZER
 template <class T>
 LList<T>::LList(std::initializer_list<T> ilist) : LList<T>() {
-    for (const auto& item : ilist) {
-        push_back(item);
-    }
+    insert(end(), ilist.begin(), ilist.end());
 }
 
 // DESTRUCTOR
@@ -300,11 +449,15 @@ LList<T>::~LList() {
     while (head != nullptr) {  // delete entire list
         temp = head;           // assign temp to first
         head = head->next;     // assign first to next node
-        delete temp;           // delete the node
+        destroy_node(temp);    // delete the node
     }
 
     tail = nullptr;
     count = 0;
+
+    while (spare != nullptr) {
+        free_spare(std::exchange(spare, spare->next));
+    }
 }
 
 // Assignment Operator Overloads
@@ -313,7 +466,7 @@ template <class T>
 LList<T>& LList<T>::operator=(const LList<T>& other) {
     if (this != &other) {  // prevent self-assignment
         LList<T> temp(other);
-        this->swap(temp);
+        this->swap_nodes(temp);
     }
     return *this;
 }
@@ -333,7 +486,7 @@ LList<T>& LList<T>::operator=(LList<T>&& other) {
 template <class T>
 LList<T>& LList<T>::operator=(std::initializer_list<T> ilist) {
     LList<T> temp(ilist);
-    this->swap(temp);
+    this->swap_nodes(temp);
     return *this;
 }
 
@@ -396,7 +549,7 @@ typename LList<T>::const_reference LList<T>::back() const {
 
 template <class T>
 void LList<T>::push_front(const T& value) {
-    Node<T>* new_node = new Node<T>(value, nullptr, head);
+    Node<T>* new_node = acquire_node(value, nullptr, head);
 
     if (empty()) {
         tail = new_node;
@@ -422,7 +575,7 @@ void LList<T>::pop_front() {
             tail = nullptr;
         }
 
-        delete temp;
+        release_node(temp);
 
         --count;
     }
@@ -430,7 +583,7 @@ void LList<T>::pop_front() {
 
 template <class T>
 void LList<T>::push_back(const T& value) {
-    Node<T>* new_node = new Node<T>(value, tail, nullptr);
+    Node<T>* new_node = acquire_node(value, tail, nullptr);
 
     if (empty()) {
         head = new_node;
@@ -456,7 +609,7 @@ void LList<T>::pop_back() {
             head = nullptr;
         }
 
-        delete temp;
+        release_node(temp);
 
         --count;
     }
@@ -472,7 +625,7 @@ typename LList<T>::iterator LList<T>::insert(const_iterator position, const T& v
     } else {
         Node<T>* current = position.current;
 
-        new_node = new Node<T>(value, current->prev, current);
+        new_node = acquire_node(value, current->prev, current);
 
         if (current->prev != nullptr) {
             current->prev->next = new_node;
@@ -492,6 +645,44 @@ typename LList<T>::iterator LList<T>::insert(const_iterator position, const T& v
     return iterator(new_node);
 }
 
+template <class T>
+template <class InputIt, class>
+typename LList<T>::iterator LList<T>::insert(const_iterator position, InputIt first,
+                                             InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+
+    // Single pass ranges cannot be counted first, they are copied node by
+    // node into a temporary list which is then spliced
+    if constexpr (!std::is_base_of<std::forward_iterator_tag, category>::value) {
+        LList<T> values;
+        for (; first != last; ++first) {
+            values.push_back(*first);
+        }
+
+        iterator inserted(values.head != nullptr ? values.head : position.current);
+        splice(position, values);
+        return inserted;
+    } else {
+        size_type n = static_cast<size_type>(std::distance(first, last));
+        if (n == 0) {
+            return iterator(position.current);
+        }
+
+        Node<T>* nodes = create_nodes(first, n);
+        link(position.current, nodes, nodes + (n - 1));
+        count += n;
+        return iterator(nodes);
+    }
+}
+
+template <class T>
+template <class InputIt, class>
+void LList<T>::assign(InputIt first, InputIt last) {
+    LList<T> values;
+    values.insert(values.end(), first, last);
+    swap_nodes(values);
+}
+
 template <class T>
 typename LList<T>::iterator LList<T>::erase(const_iterator position) {
     if (position == end()) {
@@ -515,7 +706,7 @@ typename LList<T>::iterator LList<T>::erase(const_iterator position) {
 
     next_node = iterator(current->next);
 
-    delete current;
+    release_node(current);
 
     --count;
 
@@ -524,6 +715,16 @@ typename LList<T>::iterator LList<T>::erase(const_iterator position) {
 
 template <class T>
 void LList<T>::swap(LList& other) {
+    swap_nodes(other);
+
+    // Swap spare nodes
+    std::swap(spare, other.spare);
+    std::swap(spare_count, other.spare_count);
+    std::swap(retain, other.retain);
+}
+
+template <class T>
+void LList<T>::swap_nodes(LList& other) noexcept {
      // Swap heads
     Node<T>* tempHead = head;
     head = other.head;
@@ -547,4 +748,346 @@ void LList<T>::clear() noexcept {
     }
 }
 
+// capacity
+
+template <class T>
+void LList<T>::reserve(size_type n) {
+    retain = true;
+    if (n <= capacity()) {
+        return;
+    }
+
+    // Storage only, the nodes are constructed when they are used
+    size_type missing = n - capacity();
+    if constexpr (alignof(Node<T>) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        for (size_type i = 0; i < missing; ++i) {
+            void* storage = ::operator new(sizeof(Node<T>), std::align_val_t(alignof(Node<T>)));
+            spare = new (storage) SpareLink{spare, nullptr};
+        }
+    } else {
+        void* storage = ::operator new(NodeBlock<T>::offset + missing * sizeof(Node<T>));
+        NodeBlock<T>* block = new (storage) NodeBlock<T>{missing};
+        for (size_type i = 0; i < missing; ++i) {
+            spare = new (static_cast<void*>(block->nodes() + i)) SpareLink{spare, block};
+        }
+    }
+    spare_count += missing;
+
+    if (alloc_track::active()) {
+        alloc_track::on_reserve<T>(missing, missing * sizeof(Node<T>));
+    }
+}
+
+template <class T>
+void LList<T>::shrink_to_fit() noexcept {
+    while (spare != nullptr) {
+        free_spare(std::exchange(spare, spare->next));
+    }
+    spare_count = 0;
+    retain = false;
+}
+
+// operations
+
+template <class T>
+void LList<T>::splice(const_iterator position, LList& other) {
+    if (&other == this || other.empty()) {
+        return;
+    }
+
+    link(position.current, other.head, other.tail);
+    count += std::exchange(other.count, 0);
+    other.head = nullptr;
+    other.tail = nullptr;
+}
+
+template <class T>
+void LList<T>::splice(const_iterator position, LList& other, const_iterator it) {
+    if (it == other.end()) {
+        throw std::invalid_argument("cannot splice end() iterator");
+    }
+
+    // A node of another list is never in place, even its tail before end()
+    Node<T>* node = it.current;
+    if (&other == this && (node == position.current || node->next == position.current)) {
+        return;  // already in place
+    }
+
+    other.unlink(node, node);
+    link(position.current, node, node);
+
+    if (&other != this) {
+        --other.count;
+        ++count;
+    }
+}
+
+template <class T>
+void LList<T>::splice(const_iterator position, LList& other, const_iterator first,
+                      const_iterator last) {
+    if (first == last) {
+        return;
+    }
+
+    Node<T>* first_node = first.current;
+    Node<T>* last_node = last == other.end() ? other.tail : last.current->prev;
+    size_type n = &other == this ? 0 : static_cast<size_type>(std::distance(first, last));
+
+    other.unlink(first_node, last_node);
+    link(position.current, first_node, last_node);
+
+    other.count -= n;
+    count += n;
+}
+
+template <class T>
+void LList<T>::sort() {
+    sort(std::less<T>());
+}
+
+template <class T>
+template <class Compare>
+void LList<T>::sort(Compare comp) {
+    if (count < 2) {
+        return;
+    }
+
+    // Bottom-up merge sort: runs of width nodes are merged in pairs, with
+    // the width doubling until a single run is left. The next links are
+    // rebuilt by the merges and the prev links are fixed on the way.
+    Node<T>* list = head;
+
+    for (size_type width = 1; ; width *= 2) {
+        Node<T>* left = list;
+        Node<T>* last = nullptr;
+        size_type merges = 0;
+        list = nullptr;
+
+        while (left != nullptr) {
+            Node<T>* right = left;
+            size_type left_size = 0;
+            size_type right_size = width;
+            ++merges;
+
+            while (left_size < width && right != nullptr) {
+                ++left_size;
+                right = right->next;
+            }
+
+            while (left_size > 0 || (right_size > 0 && right != nullptr)) {
+                Node<T>* node;
+
+                // Ties are taken from the left run, which keeps the sort stable
+                if (left_size == 0) {
+                    node = right;
+                    right = right->next;
+                    --right_size;
+                } else if (right_size == 0 || right == nullptr ||
+                           !comp(right->data, left->data)) {
+                    node = left;
+                    left = left->next;
+                    --left_size;
+                } else {
+                    node = right;
+                    right = right->next;
+                    --right_size;
+                }
+
+                if (last != nullptr) {
+                    last->next = node;
+                } else {
+                    list = node;
+                }
+                node->prev = last;
+                last = node;
+            }
+
+            left = right;
+        }
+
+        last->next = nullptr;
+
+        if (merges <= 1) {
+            head = list;
+            tail = last;
+            return;
+        }
+    }
+}
+
+template <class T>
+void LList<T>::reverse() noexcept {
+    for (Node<T>* node = head; node != nullptr; node = node->prev) {
+        std::swap(node->prev, node->next);
+    }
+    std::swap(head, tail);
+}
+
+template <class T>
+void LList<T>::link(Node<T>* position, Node<T>* first, Node<T>* last) noexcept {
+    Node<T>* before = position != nullptr ? position->prev : tail;
+
+    first->prev = before;
+    last->next = position;
+
+    if (before != nullptr) {
+        before->next = first;
+    } else {
+        head = first;
+    }
+
+    if (position != nullptr) {
+        position->prev = last;
+    } else {
+        tail = last;
+    }
+}
+
+template <class T>
+void LList<T>::unlink(Node<T>* first, Node<T>* last) noexcept {
+    if (first->prev != nullptr) {
+        first->prev->next = last->next;
+    } else {
+        head = last->next;
+    }
+
+    if (last->next != nullptr) {
+        last->next->prev = first->prev;
+    } else {
+        tail = first->prev;
+    }
+}
+
+// node allocation
+
+template <class T>
+Node<T>* LList<T>::create_node(const T& value, Node<T>* prev, Node<T>* next) {
+    Node<T>* node = new Node<T>(value, prev, next);
+
+    if (alloc_track::active()) {
+        alloc_track::on_alloc<T>(1, sizeof(Node<T>));
+    }
+
+    return node;
+}
+
+template <class T>
+template <class ForwardIt>
+Node<T>* LList<T>::create_nodes(ForwardIt first, size_type n) {
+    // Types aligned beyond what operator new guarantees get single nodes
+    if (n == 1 || alignof(Node<T>) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        Node<T>* chain = create_node(*first, nullptr, nullptr);
+        Node<T>* last = chain;
+        try {
+            for (++first; --n > 0; ++first) {
+                last->next = create_node(*first, last, nullptr);
+                last = last->next;
+            }
+        } catch (...) {
+            while (chain != nullptr) {
+                destroy_node(std::exchange(chain, chain->next));
+            }
+            throw;
+        }
+        return chain;
+    }
+
+    void* storage = ::operator new(NodeBlock<T>::offset + n * sizeof(Node<T>));
+    NodeBlock<T>* block = new (storage) NodeBlock<T>{n};
+    Node<T>* nodes = block->nodes();
+    size_type built = 0;
+
+    try {
+        for (; built < n; ++built, ++first) {
+            new (nodes + built) Node<T>(*first, built > 0 ? nodes + built - 1 : nullptr,
+                                        built + 1 < n ? nodes + built + 1 : nullptr, block);
+        }
+    } catch (...) {
+        while (built > 0) {
+            nodes[--built].~Node<T>();
+        }
+        ::operator delete(storage);
+        throw;
+    }
+
+    if (alloc_track::active()) {
+        alloc_track::on_alloc<T>(n, n * sizeof(Node<T>));
+    }
+
+    return nodes;
+}
+
+template <class T>
+Node<T>* LList<T>::acquire_node(const T& value, Node<T>* prev, Node<T>* next) {
+    if (spare == nullptr) {
+        return create_node(value, prev, next);
+    }
+
+    SpareLink link = *spare;
+    void* storage = spare;
+    try {
+        Node<T>* node = new (storage) Node<T>(value, prev, next, link.block);
+        spare = link.next;
+        --spare_count;
+        return node;
+    } catch (...) {
+        new (storage) SpareLink(link);  // still a spare
+        throw;
+    }
+}
+
+template <class T>
+void LList<T>::release_node(Node<T>* node) noexcept {
+    if (!retain) {
+        destroy_node(node);
+        return;
+    }
+
+    NodeBlock<T>* block = node->block;
+    node->~Node<T>();
+    spare = new (static_cast<void*>(node)) SpareLink{spare, block};
+    ++spare_count;
+}
+
+template <class T>
+void LList<T>::free_spare(SpareLink* link) noexcept {
+    NodeBlock<T>* block = link->block;
+
+    // Same deallocation as destroy_node(), the node is already destroyed
+    if (block != nullptr) {
+        if (--block->live == 0) {
+            block->~NodeBlock<T>();
+            ::operator delete(block);
+        }
+    } else if constexpr (alignof(Node<T>) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(static_cast<void*>(link), std::align_val_t(alignof(Node<T>)));
+    } else {
+        ::operator delete(static_cast<void*>(link));
+    }
+
+    if (alloc_track::active()) {
+        alloc_track::on_free<T>(1, sizeof(Node<T>));
+    }
+}
+
+template <class T>
+void LList<T>::destroy_node(Node<T>* node) {
+    NodeBlock<T>* block = node->block;
+
+    // A block is freed with its last node
+    if (block != nullptr) {
+        node->~Node<T>();
+        if (--block->live == 0) {
+            block->~NodeBlock<T>();
+            ::operator delete(block);
+        }
+    } else {
+        delete node;
+    }
+
+    if (alloc_track::active()) {
+        alloc_track::on_free<T>(1, sizeof(Node<T>));
+    }
+}
+
 #endif // LLIST_HPP
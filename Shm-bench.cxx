@@ -0,0 +1,111 @@
+/// @file Shm-bench.cxx
+/// @author Etienne Bravo
+///
+/// @brief Round trip latency of the shared memory service. Start a server,
+/// then run the benchmark against it:
+///
+///   ./postfix_calc --shm-serve=/postfix_calc &
+///   shm_bench /postfix_calc [round_trips] [expression]
+///
+/// The first part times round_trips single requests (10^5 by default) and
+/// prints the latency distribution. The second keeps the ring full and
+/// prints the time per expression when requests are pipelined.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "shm_ring.hpp"  // check include guard
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/// Requests sent before timing starts.
+const std::size_t warm_up = 10000;
+
+double elapsed_ns(clock_type::time_point start, clock_type::time_point stop) {
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/// Times single round trips and prints the distribution.
+void bench_round_trips(ShmClient& client, const std::string& expression, std::size_t rounds) {
+    std::vector<double> samples(rounds);
+
+    for (std::size_t i = 0; i < rounds; ++i) {
+        clock_type::time_point start = clock_type::now();
+        client.evaluate(expression);
+        samples[i] = elapsed_ns(start, clock_type::now());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+
+    auto percentile = [&](double p) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+    };
+
+    std::printf("round trip ns: mean %.0f  min %.0f  p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f\n",
+                total / rounds, samples.front(), percentile(0.5), percentile(0.9),
+                percentile(0.99), percentile(0.999), samples.back());
+}
+
+/// Keeps capacity() requests in flight and prints the time per expression.
+void bench_pipelined(ShmClient& client, const std::string& expression, std::size_t rounds) {
+    std::string result;
+    std::size_t sent = 0;
+    std::size_t received = 0;
+
+    clock_type::time_point start = clock_type::now();
+    while (received < rounds) {
+        while (sent < rounds && client.pending() < ShmClient::capacity()) {
+            client.submit(expression);
+            ++sent;
+        }
+        client.receive(result);
+        ++received;
+    }
+    double ns = elapsed_ns(start, clock_type::now());
+
+    std::printf("pipelined:     %.0f ns per expression, %.2f M expressions/s\n",
+                ns / rounds, rounds / ns * 1000);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s NAME [round_trips] [expression]\n", argv[0]);
+        return 1;
+    }
+
+    std::size_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    std::string expression = argc > 3 ? argv[3] : "( 1234 + 5678 ) * 910";
+
+    try {
+        ShmClient client(argv[1]);
+        std::printf("%s = %s\n", expression.c_str(), client.evaluate(expression).c_str());
+
+        for (std::size_t i = 0; i < warm_up; ++i) {
+            client.evaluate(expression);
+        }
+
+        bench_round_trips(client, expression, std::max<std::size_t>(rounds, 1));
+        bench_pipelined(client, expression, std::max<std::size_t>(rounds, 1));
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+/* EOF */
@@ -4,6 +4,9 @@
 /// @note I pledge my word of honor that I have complied with the
 /// CSN Academic Integrity Policy while completing this assignment.
 
+#ifndef STACK_HPP
+#define STACK_HPP
+
 #include "LList.hpp"
 
 /// @brief A Stack class template implementing a LIFO data structure.
@@ -45,6 +48,20 @@ public:
     /// @return The number of elements in the stack.
     size_type size() const { return LList<T>::size(); }
 
+    /// Keeps storage for n elements, see LList::reserve().
+    /// @param n Number of elements to keep storage for.
+    void reserve(size_type n) { LList<T>::reserve(n); }
+
+    /// Returns the number of elements the stack can hold without allocating.
+    /// @return The capacity of the stack.
+    size_type capacity() const { return LList<T>::capacity(); }
+
+    /// Removes all elements, a reserved stack keeps its storage.
+    void clear() { LList<T>::clear(); }
+
+    /// Frees the storage of the removed elements.
+    void shrink_to_fit() { LList<T>::shrink_to_fit(); }
+
     /// Accesses the top element.
     /// @return A reference to the top element in the stack.
     reference top() { return LList<T>::back(); }
@@ -64,3 +81,5 @@ public:
     /// @param other Another stack to swap the contents with.
     void swap(Stack& other) { LList<T>::swap(other); }
 };
+
+#endif // STACK_HPP
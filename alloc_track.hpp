@@ -0,0 +1,240 @@
+/// @file alloc_track.hpp
+/// @author Etienne Bravo
+///
+/// @brief Opt-in counters for the node allocations made by LList, and by
+/// the Stack class built on it.
+///
+/// Tracking is off by default and costs one relaxed atomic load per node
+/// allocation or free. Once enabled, every allocation is counted twice: in
+/// the counters of the container type (LList<char>, LList<int>, ...) and in
+/// the counters of the phase the calling thread is in (conversion to
+/// Postfix, evaluation, or other). Storage set aside by reserve() has a
+/// phase of its own, it is paid once and not by each expression.
+///
+/// Example Usage:
+/// @code
+///   alloc_track::enable();
+///   std::string postfix = infix2postfix("2 + 3 * 4");
+///   int result = eval_postfix(postfix);
+///   alloc_track::report(std::cerr, 1);
+/// @endcode
+
+#ifndef ALLOC_TRACK_HPP
+#define ALLOC_TRACK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+namespace alloc_track {
+
+/// Phases of the evaluation of an expression.
+enum Phase {
+    OTHER,     ///< anything not covered below
+    RESERVE,   ///< LList::reserve(), storage kept for the expressions to come
+    CONVERT,   ///< infix2postfix() and ShapeBatch::add(), not the single pass evaluators
+    EVALUATE,  ///< eval_postfix() and the other evaluators, eval_infix() included
+    PHASES     ///< number of phases
+};
+
+/// Counters of one container type or one phase.
+struct Counters {
+    std::atomic<std::size_t> allocations{0};  ///< nodes allocated
+    std::atomic<std::size_t> frees{0};        ///< nodes freed
+    std::atomic<std::size_t> bytes{0};        ///< bytes allocated
+    std::atomic<long>        live_nodes{0};   ///< allocated minus freed
+    std::atomic<long>        peak_nodes{0};   ///< highest live_nodes
+    std::atomic<long>        live_bytes{0};   ///< bytes of the live nodes
+    std::atomic<long>        peak_bytes{0};   ///< highest live_bytes
+};
+
+/// Plain copy of a Counters object, returned by the query functions.
+struct Snapshot {
+    std::size_t allocations;
+    std::size_t frees;
+    std::size_t bytes;
+    long        peak_nodes;
+    long        peak_bytes;
+};
+
+/// Counters of one container type, kept in a list to be reported.
+struct ContainerStats {
+    std::string     name;
+    Counters        counters;
+    Counters        reserved;  ///< the part of counters made by reserve()
+    ContainerStats* next;
+};
+
+inline std::atomic<bool>            tracking{false};
+inline std::atomic<ContainerStats*> containers_head{nullptr};
+inline Counters                     phase_counters[PHASES];
+inline thread_local Phase           current_phase = OTHER;
+
+/// Starts or stops counting.
+inline void enable(bool on = true) { tracking.store(on, std::memory_order_relaxed); }
+
+/// @return True if allocations are being counted.
+inline bool active() { return tracking.load(std::memory_order_relaxed); }
+
+/// Sets the phase of the calling thread for the lifetime of the object.
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase phase) : saved(current_phase) { current_phase = phase; }
+    ~PhaseScope() { current_phase = saved; }
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    Phase saved;
+};
+
+/// Raises peak to value if value is higher.
+inline void raise(std::atomic<long>& peak, long value) {
+    long seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+/// Counts the allocation of nodes.
+inline void record_alloc(Counters& counters, std::size_t nodes, std::size_t bytes) {
+    counters.allocations.fetch_add(nodes, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    raise(counters.peak_nodes, counters.live_nodes.fetch_add(nodes, std::memory_order_relaxed) + nodes);
+    raise(counters.peak_bytes, counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+/// Counts the release of nodes.
+inline void record_free(Counters& counters, std::size_t nodes, std::size_t bytes) {
+    counters.frees.fetch_add(nodes, std::memory_order_relaxed);
+    counters.live_nodes.fetch_sub(nodes, std::memory_order_relaxed);
+    counters.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+/// @tparam T Element type of the container.
+/// @return The counters of LList<T>, registered for report() on first use.
+template <class T>
+ContainerStats& container_stats() {
+    static ContainerStats* stats = [] {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status);
+        ContainerStats* created = new ContainerStats;
+        created->name = std::string("LList<") + (status == 0 ? demangled : typeid(T).name()) + ">";
+        std::free(demangled);
+
+        created->next = containers_head.load(std::memory_order_relaxed);
+        while (!containers_head.compare_exchange_weak(created->next, created)) {
+        }
+        return created;
+    }();
+    return *stats;
+}
+
+/// Called by LList when it allocates nodes.
+template <class T>
+void on_alloc(std::size_t nodes, std::size_t bytes) {
+    record_alloc(container_stats<T>().counters, nodes, bytes);
+    record_alloc(phase_counters[current_phase], nodes, bytes);
+}
+
+/// Called by LList when reserve() allocates storage for nodes.
+template <class T>
+void on_reserve(std::size_t nodes, std::size_t bytes) {
+    ContainerStats& stats = container_stats<T>();
+    record_alloc(stats.counters, nodes, bytes);
+    record_alloc(stats.reserved, nodes, bytes);
+    record_alloc(phase_counters[RESERVE], nodes, bytes);
+}
+
+/// Called by LList when it frees nodes.
+template <class T>
+void on_free(std::size_t nodes, std::size_t bytes) {
+    record_free(container_stats<T>().counters, nodes, bytes);
+    record_free(phase_counters[current_phase], nodes, bytes);
+}
+
+/// @return A copy of counters.
+inline Snapshot snapshot(const Counters& counters) {
+    return Snapshot{counters.allocations.load(), counters.frees.load(), counters.bytes.load(),
+                    counters.peak_nodes.load(), counters.peak_bytes.load()};
+}
+
+/// @return The counters of a phase.
+inline Snapshot phase(Phase phase) { return snapshot(phase_counters[phase]); }
+
+/// @return The counters of LList<T>.
+template <class T>
+Snapshot container() { return snapshot(container_stats<T>().counters); }
+
+/// Clears all counters, peaks restart from the nodes that are still live.
+inline void reset() {
+    auto clear = [](Counters& counters) {
+        counters.allocations = 0;
+        counters.frees = 0;
+        counters.bytes = 0;
+        counters.peak_nodes = counters.live_nodes.load();
+        counters.peak_bytes = counters.live_bytes.load();
+    };
+    for (Counters& counters : phase_counters) {
+        clear(counters);
+    }
+    for (ContainerStats* s = containers_head.load(); s != nullptr; s = s->next) {
+        clear(s->counters);
+        clear(s->reserved);
+    }
+}
+
+/// Prints a table of the counters of every phase and container type.
+/// The reserve phase has no per expression averages, and the averages of
+/// the containers leave out what reserve() allocated.
+/// @param os Stream to print to.
+/// @param expressions Number of expressions evaluated, for per expression
+/// averages. Zero leaves the averages out.
+inline void report(std::ostream& os, std::size_t expressions) {
+    static const char* const phase_names[PHASES] = {"other", "reserve", "convert", "evaluate"};
+
+    // reserved is subtracted from the averages, null for no averages
+    auto row = [&](const std::string& name, const Snapshot& s, const Snapshot* reserved) {
+        os << std::left << std::setw(24) << name << std::right
+           << std::setw(12) << s.allocations << std::setw(12) << s.frees
+           << std::setw(14) << s.bytes << std::setw(12) << s.peak_nodes
+           << std::setw(12) << s.peak_bytes;
+        if (expressions != 0 && reserved != nullptr) {
+            os << std::setw(14) << std::fixed << std::setprecision(2)
+               << static_cast<double>(s.allocations - reserved->allocations) / expressions
+               << std::setw(14) << static_cast<double>(s.bytes - reserved->bytes) / expressions;
+            os.unsetf(std::ios::fixed);
+        }
+        os << '\n';
+    };
+
+    os << "Allocation report";
+    if (expressions != 0) {
+        os << " (" << expressions << " expressions)";
+    }
+    os << '\n' << std::left << std::setw(24) << "phase / container" << std::right
+       << std::setw(12) << "allocs" << std::setw(12) << "frees" << std::setw(14) << "bytes"
+       << std::setw(12) << "peak nodes" << std::setw(12) << "peak bytes";
+    if (expressions != 0) {
+        os << std::setw(14) << "allocs/expr" << std::setw(14) << "bytes/expr";
+    }
+    os << '\n';
+
+    const Snapshot none{};
+    for (int p = 0; p < PHASES; ++p) {
+        row(phase_names[p], phase(static_cast<Phase>(p)), p == RESERVE ? nullptr : &none);
+    }
+    for (ContainerStats* s = containers_head.load(); s != nullptr; s = s->next) {
+        Snapshot reserved = snapshot(s->reserved);
+        row(s->name, snapshot(s->counters), &reserved);
+    }
+}
+
+} // namespace alloc_track
+
+#endif // ALLOC_TRACK_HPP
@@ -0,0 +1,326 @@
+/// @file async-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the AsyncCalculator class of libpostfix: short
+/// expressions complete inline, medium ones yield to the loop, long ones
+/// run on a worker and resume on the loop, and errors and exceeded limits
+/// reach the awaiting coroutine. Build with
+///
+///   make lib && g++ -std=gnu++20 async-test.cxx libpostfix.a -pthread -lrt
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "async_eval.hpp"  // check include guard
+#include "eval_limits.hpp"
+#include "postfix.hpp"
+
+// Coroutine that starts right away and is never awaited
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// What an evaluation gave and where it resumed
+struct Outcome {
+    bool            done = false;
+    int             value = 0;
+    std::string     error;
+    EvalStatus      status = EvalStatus::OK;  ///< of an exceeded limit
+    std::thread::id thread;
+};
+
+Task evaluate(AsyncCalculator<int>& calc, const std::string& expression, bool postfix, Outcome& outcome) {
+    try {
+        outcome.value = co_await (postfix ? calc.eval_postfix_async(expression) : calc.eval_async(expression));
+    } catch (const LimitExceeded& e) {
+        outcome.error = e.what();
+        outcome.status = e.status();
+    } catch (const std::exception& e) {
+        outcome.error = e.what();
+    }
+    outcome.thread = std::this_thread::get_id();
+    outcome.done = true;
+}
+
+// "1 + 2 + ... + n", two tokens per term
+std::string sum(int n) {
+    std::string expression = "1";
+    for (int i = 2; i <= n; ++i) {
+        expression += " + " + std::to_string(i);
+    }
+    return expression;
+}
+
+// Test the three ways of evaluating
+TEST_CASE("evaluation", "[async]") {
+    Executor loop;
+    Executor workers(2);
+    AsyncPolicy policy;
+    policy.inline_bytes = 64;
+    policy.offload_bytes = 64 << 10;
+    policy.yield_tokens = 1000;
+    AsyncCalculator<int> calc(loop, workers, policy);
+    Outcome outcome;
+
+    SECTION("short expressions complete inline") {
+        evaluate(calc, "( 2 + 3 ) * 4", false, outcome);
+        CHECK(outcome.done);
+        CHECK(outcome.value == 20);
+        CHECK(loop.poll() == 0);
+    }
+
+    SECTION("medium expressions yield every yield_tokens tokens") {
+        std::string expression = sum(4000);  // about 8000 tokens
+        Outcome other;
+        evaluate(calc, expression, false, outcome);
+        evaluate(calc, expression, false, other);
+        CHECK_FALSE(outcome.done);
+
+        int rounds = 0;
+        while (!outcome.done || !other.done) {
+            CHECK(loop.poll() == 2);  // both get a turn every round
+            ++rounds;
+        }
+        CHECK(rounds >= 7);
+        CHECK(outcome.value == eval_infix<int>(expression));
+        CHECK(other.value == outcome.value);
+        CHECK(outcome.thread == std::this_thread::get_id());
+    }
+
+    SECTION("long expressions run on a worker and resume on the loop") {
+        std::string expression = sum(20000);
+        evaluate(calc, expression, false, outcome);
+        CHECK_FALSE(outcome.done);
+        while (!outcome.done) {
+            loop.run_one();
+        }
+        CHECK(outcome.value == eval_infix<int>(expression));
+        CHECK(outcome.thread == std::this_thread::get_id());
+    }
+
+    SECTION("postfix expressions") {
+        std::string infix = sum(2000);
+        std::string postfix = infix2postfix(infix);
+        evaluate(calc, postfix, true, outcome);
+        while (!outcome.done) {
+            loop.run_one();
+        }
+        CHECK(outcome.value == eval_infix<int>(infix));
+
+        Outcome small;
+        evaluate(calc, "6 7 *", true, small);
+        CHECK(small.value == 42);
+    }
+}
+
+// Test errors
+TEST_CASE("errors", "[async]") {
+    Executor loop;
+    Executor workers(1);
+    AsyncPolicy policy;
+    policy.inline_bytes = 16;
+    policy.offload_bytes = 4096;
+    policy.yield_tokens = 10;
+    AsyncCalculator<int> calc(loop, workers, policy);
+    std::string tail = " + 1 / 0";
+
+    for (int terms : {1, 100, 2000}) {  // short, medium and long
+        Outcome outcome;
+        std::string expression = sum(terms) + tail;
+        evaluate(calc, expression, false, outcome);
+        while (!outcome.done) {
+            loop.run_one();
+        }
+        CHECK(outcome.error == "division by zero");
+    }
+
+    policy.yield_tokens = 0;
+    CHECK_THROWS_AS(AsyncCalculator<int>(loop, workers, policy), std::invalid_argument);
+}
+
+// Test that malformed Postfix expressions fail the same way inline, in
+// slices and on a worker
+TEST_CASE("malformed postfix", "[async]") {
+    Executor loop;
+    Executor workers(1);
+    AsyncPolicy inline_only;
+    inline_only.inline_bytes = SIZE_MAX;
+    AsyncPolicy sliced;
+    sliced.inline_bytes = 0;
+    sliced.offload_bytes = SIZE_MAX;
+    sliced.yield_tokens = 100;
+    AsyncPolicy offloaded;
+    offloaded.inline_bytes = 0;
+    offloaded.offload_bytes = 0;
+    AsyncCalculator<int> calcs[] = {{loop, workers, inline_only}, {loop, workers, sliced}, {loop, workers, offloaded}};
+    const char* names[] = {"inline", "sliced", "offloaded"};
+
+    std::vector<std::string> expressions{"", "+", "1 +", "1 2", "1 2 + +", "1 2 3 +"};
+    for (int terms : {4, 2000}) {
+        std::string base = infix2postfix(sum(terms));  // "1 2 + 3 + ... n + "
+        std::size_t middle = base.find(" + ", base.size() / 2) + 3;
+        expressions.push_back(base + "+");                                           // an operator too many
+        expressions.push_back("+ " + base);                                          // an operator first
+        expressions.push_back(base + "7");                                           // an operand left over
+        expressions.push_back(base.substr(0, middle) + "* " + base.substr(middle));  // short in the middle
+    }
+
+    for (const std::string& expression : expressions) {
+        for (int policy = 0; policy < 3; ++policy) {
+            INFO(names[policy] << ": " << expression.substr(0, 40) << " (" << expression.size() << " bytes)");
+            Outcome outcome;
+            evaluate(calcs[policy], expression, true, outcome);
+            while (!outcome.done) {
+                loop.run_one();
+            }
+            CHECK(outcome.error == "malformed expression");
+            CHECK_THROWS_WITH(eval_postfix<int>(expression), outcome.error);
+        }
+    }
+}
+
+// Test that malformed Infix expressions fail the same way inline, in
+// slices and on a worker
+TEST_CASE("malformed infix", "[async]") {
+    Executor loop;
+    Executor workers(1);
+    AsyncPolicy inline_only;
+    inline_only.inline_bytes = SIZE_MAX;
+    AsyncPolicy sliced;
+    sliced.inline_bytes = 0;
+    sliced.offload_bytes = SIZE_MAX;
+    sliced.yield_tokens = 100;
+    AsyncPolicy offloaded;
+    offloaded.inline_bytes = 0;
+    offloaded.offload_bytes = 0;
+    AsyncCalculator<int> calcs[] = {{loop, workers, inline_only}, {loop, workers, sliced}, {loop, workers, offloaded}};
+    const char* names[] = {"inline", "sliced", "offloaded"};
+
+    std::vector<std::string> expressions{"", "1 2", "1 +", "( 1 + 2", "1 + 2 )", ") 1 ("};
+    for (int terms : {4, 2000}) {
+        std::string base = sum(terms);
+        expressions.push_back(base + " 7");          // an operand left over
+        expressions.push_back("( " + base);          // a parenthesis never closed
+        expressions.push_back(base + " )");          // one never opened
+        expressions.push_back(base + " + ( 1 2 )");  // two operands at the end
+    }
+
+    for (const std::string& expression : expressions) {
+        for (int policy = 0; policy < 3; ++policy) {
+            INFO(names[policy] << ": " << expression.substr(0, 40) << " (" << expression.size() << " bytes)");
+            Outcome outcome;
+            evaluate(calcs[policy], expression, false, outcome);
+            while (!outcome.done) {
+                loop.run_one();
+            }
+            CHECK(outcome.error == "malformed expression");
+            CHECK_THROWS_WITH(eval_infix<int>(expression), outcome.error);
+        }
+    }
+}
+
+// Test limits, whichever way the expression is evaluated
+TEST_CASE("limits", "[async]") {
+    Executor loop;
+    Executor workers(1);
+    AsyncPolicy policy;
+    policy.inline_bytes = 64;
+    policy.offload_bytes = 16 << 10;
+    policy.yield_tokens = 100;
+    AsyncCalculator<int> calc(loop, workers, policy);
+    CancelToken cancel;
+    EvalLimits limits;
+    limits.cancel = &cancel;
+
+    auto run = [&](const std::string& expression, bool postfix) {
+        Outcome outcome;
+        evaluate(calc, expression, postfix, outcome);
+        while (!outcome.done) {
+            loop.run_one();
+        }
+        return outcome;
+    };
+
+    SECTION("token limit") {
+        for (int terms : {4, 2000, 10000}) {  // short, medium and long
+            std::string infix = sum(terms);
+            std::size_t tokens = 2 * terms - 1;
+            for (bool postfix : {false, true}) {
+                std::string expression = postfix ? infix2postfix(infix) : infix;
+                INFO(tokens << " tokens, " << expression.size() << " bytes" << (postfix ? ", postfix" : ""));
+
+                limits.max_tokens = tokens;
+                calc.set_limits(limits);
+                Outcome outcome = run(expression, postfix);
+                CHECK(outcome.error == "");
+                CHECK(outcome.value == terms * (terms + 1) / 2);
+
+                limits.max_tokens = tokens - 1;
+                calc.set_limits(limits);
+                outcome = run(expression, postfix);
+                CHECK(outcome.status == EvalStatus::TOKEN_LIMIT);
+                CHECK(outcome.error == "token limit exceeded");
+            }
+        }
+
+        // The Calculator of the thread keeps its own limits
+        CHECK(eval_infix<int>(sum(100)) == 5050);
+    }
+
+    SECTION("length limit") {
+        for (int terms : {4, 2000, 10000}) {  // short, medium and long
+            std::string infix = sum(terms);
+            INFO(infix.size() << " bytes");
+            limits.max_length = infix.size();
+            calc.set_limits(limits);
+            CHECK(run(infix, false).value == terms * (terms + 1) / 2);
+
+            limits.max_length = infix.size() - 1;
+            calc.set_limits(limits);
+            CHECK(run(infix, false).status == EvalStatus::LENGTH_LIMIT);
+            CHECK(run(std::string(infix.size(), 'x'), false).status == EvalStatus::LENGTH_LIMIT);
+        }
+    }
+
+    SECTION("cancelled before the evaluation") {
+        calc.set_limits(limits);
+        cancel.cancel();
+        for (int terms : {4, 2000, 10000}) {
+            INFO(terms << " terms");
+            CHECK(run(sum(terms), false).status == EvalStatus::CANCELLED);
+            CHECK(run(infix2postfix(sum(terms)), true).status == EvalStatus::CANCELLED);
+        }
+
+        cancel.reset();
+        CHECK(run(sum(2000), false).value == 2001000);
+    }
+
+    SECTION("cancelled between two slices") {
+        calc.set_limits(limits);
+        Outcome outcome;
+        evaluate(calc, sum(2000), false, outcome);
+        CHECK(loop.poll() == 1);
+        CHECK_FALSE(outcome.done);
+
+        cancel.cancel();
+        CHECK(loop.poll() == 1);
+        CHECK(outcome.done);
+        CHECK(outcome.status == EvalStatus::CANCELLED);
+        CHECK(outcome.error == "cancelled");
+    }
+}
+
+/* EOF */
@@ -0,0 +1,281 @@
+/// @file async_eval.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the Executor, Evaluation and AsyncCalculator
+/// classes.
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "alloc_track.hpp"
+#include "async_eval.hpp"
+#include "calculator.hpp"
+#include "numeric.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// Gives the Calculator of the thread the limits of one evaluation, and
+/// its own back when the evaluation is over.
+template <class Num>
+class LimitsScope {
+public:
+    LimitsScope(Calculator<Num>& calculator, const EvalLimits& limits)
+    : calculator(calculator), saved(calculator.current_limits())
+    {
+        calculator.set_limits(limits);
+    }
+
+    ~LimitsScope() { calculator.set_limits(saved); }
+
+private:
+    Calculator<Num>& calculator;
+    EvalLimits       saved;
+};
+
+} // namespace
+
+Executor::Executor(unsigned threads)
+{
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([this] { work(); });
+    }
+}
+
+Executor::~Executor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready_cv.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    // Without workers, whatever is left runs here
+    while (!jobs.empty())
+    {
+        poll();
+    }
+}
+
+void Executor::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    ready_cv.notify_one();
+}
+
+void Executor::run_one()
+{
+    std::function<void()> job;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready_cv.wait(lock, [this] { return !jobs.empty(); });
+        job = std::move(jobs.front());
+        jobs.pop_front();
+    }
+    job();
+}
+
+std::size_t Executor::poll()
+{
+    std::deque<std::function<void()>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(jobs);
+    }
+    for (std::function<void()>& job : batch)
+    {
+        job();
+    }
+    return batch.size();
+}
+
+void Executor::work()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+            {
+                return;  // stopping, and nothing left to run
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+template <class Num>
+bool Evaluation<Num>::await_suspend(std::coroutine_handle<> handle)
+{
+    waiter = handle;
+
+    // Long: a worker evaluates, the loop resumes
+    if (expression.size() >= policy.offload_bytes)
+    {
+        workers.post([this]
+        {
+            try
+            {
+                Calculator<Num>& calculator = Calculator<Num>::local();
+                LimitsScope<Num> scope(calculator, limits);
+                result = postfix ? calculator.eval_postfix(expression) : calculator.eval_infix(expression);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            loop.post(waiter);
+        });
+        return true;
+    }
+
+    // Medium: slices on the loop, the first one right away
+    reducer.reserve(Calculator<Num>::default_depth);
+    if (step())
+    {
+        return false;
+    }
+    loop.post([this] { next_step(); });
+    return true;
+}
+
+template <class Num>
+Num Evaluation<Num>::await_resume()
+{
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (result)
+    {
+        return *result;
+    }
+
+    // Short: never suspended
+    Calculator<Num>& calculator = Calculator<Num>::local();
+    LimitsScope<Num> scope(calculator, limits);
+    return postfix ? calculator.eval_postfix(expression) : calculator.eval_infix(expression);
+}
+
+template <class Num>
+bool Evaluation<Num>::step()
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    trace::Span span(trace::EVALUATE);
+
+    try
+    {
+        // Other jobs ran on the loop since the last slice
+        if (budget)
+        {
+            budget->check();
+        }
+        else
+        {
+            budget.emplace(limits, expression.size());
+            classify(expression.data(), expression.size(), classes);
+            lexer.emplace(expression.data(), classes);
+        }
+
+        for (std::size_t n = 0; n < policy.yield_tokens; ++n)
+        {
+            Token token = lexer->next();
+            if (token.kind == Token::END)
+            {
+                // Operands left over, or none at all, like the Calculator
+                if (postfix && reducer.value_depth() != 1)
+                {
+                    throw std::invalid_argument(status_name(EvalStatus::MALFORMED));
+                }
+                if (!postfix)
+                {
+                    grammar.finish();
+                }
+                result = reducer.finish();
+                return true;
+            }
+
+            budget->token();
+            if (token.kind == Token::NUMBER)
+            {
+                if (!postfix)
+                {
+                    grammar.value();
+                }
+                reducer.push_value(Numeric<Num>::parse(token.first, token.last));
+                budget->stack(reducer.value_depth());
+            }
+            else if (postfix)
+            {
+                if (reducer.value_depth() < 2)
+                {
+                    throw std::invalid_argument(status_name(EvalStatus::MALFORMED));
+                }
+                reducer.apply(token.symbol());
+            }
+            else
+            {
+                char op = token.symbol();
+                grammar.symbol(op);
+                budget->depth(grammar.open());
+                reducer.push_operator(op);
+                budget->stack(reducer.operator_depth());
+            }
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+        reducer.reset();
+        return true;
+    }
+    return false;
+}
+
+template <class Num>
+void Evaluation<Num>::next_step()
+{
+    if (step())
+    {
+        waiter.resume();
+    }
+    else
+    {
+        loop.post([this] { next_step(); });
+    }
+}
+
+template <class Num>
+AsyncCalculator<Num>::AsyncCalculator(Executor& loop, Executor& workers, AsyncPolicy policy)
+: loop(loop), workers(workers), policy(policy)
+{
+    if (policy.yield_tokens == 0)
+    {
+        throw std::invalid_argument("yield_tokens must be at least 1");
+    }
+}
+
+// Asynchronous evaluators for the supported numeric types
+template class Evaluation<int>;
+template class Evaluation<std::int64_t>;
+template class Evaluation<__int128>;
+template class Evaluation<double>;
+template class Evaluation<Decimal>;
+
+template class AsyncCalculator<int>;
+template class AsyncCalculator<std::int64_t>;
+template class AsyncCalculator<__int128>;
+template class AsyncCalculator<double>;
+template class AsyncCalculator<Decimal>;
@@ -0,0 +1,209 @@
+/// @file async_eval.hpp
+/// @author Etienne Bravo
+///
+/// @brief Evaluation of expressions from C++20 coroutines without blocking
+/// the thread that runs them.
+
+#ifndef ASYNC_EVAL_HPP
+#define ASYNC_EVAL_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "char_class.hpp"
+#include "eval_limits.hpp"
+#include "infix_reducer.hpp"
+#include "lexer.hpp"
+
+/// @brief A queue of jobs and the threads that run them.
+///
+/// An executor with threads is a pool of workers. An executor without
+/// threads is run by its owner, with run_one() or poll(), which makes it
+/// the event loop of that thread. Jobs must not throw. The destructor runs
+/// the jobs still queued, then joins the workers.
+///
+/// Example Usage:
+/// @code
+///   Executor loop;         // run by this thread
+///   Executor workers(4);   // four threads
+///   workers.post([&] { loop.post([] { std::cout << "back on the loop\n"; }); });
+///   loop.run_one();
+/// @endcode
+
+class Executor {
+public:
+    /// @param threads Number of worker threads, 0 for none.
+    explicit Executor(unsigned threads = 0);
+
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /// Queues a job. Thread safe.
+    /// @param job The job to run.
+    void post(std::function<void()> job);
+
+    /// Queues the resumption of a coroutine. Thread safe.
+    /// @param handle The suspended coroutine.
+    void post(std::coroutine_handle<> handle) { post([handle] { handle.resume(); }); }
+
+    /// Runs one job on the calling thread, waiting for one if the queue is empty.
+    void run_one();
+
+    /// Runs the jobs queued so far on the calling thread. Jobs they queue
+    /// wait for the next call, so every job gets a turn.
+    /// @return Number of jobs run.
+    std::size_t poll();
+
+private:
+    /// Loop of a worker thread.
+    void work();
+
+    std::deque<std::function<void()>> jobs;
+    std::mutex                        mutex;     ///< protects jobs and stopping
+    std::condition_variable           ready_cv;
+    bool                              stopping = false;
+    std::vector<std::thread>          workers;
+};
+
+/// How AsyncCalculator evaluates an expression, by length in bytes.
+struct AsyncPolicy {
+    std::size_t inline_bytes  = 4 << 10;    ///< up to this, completes without suspending
+    std::size_t offload_bytes = 256 << 10;  ///< from this, evaluated by a worker thread
+    std::size_t yield_tokens  = 4096;       ///< between, tokens evaluated before each yield
+};
+
+/// @brief The awaitable returned by AsyncCalculator, see there.
+/// @tparam Num Numeric type used for operands and results.
+template <class Num>
+class Evaluation {
+public:
+    Evaluation(Executor& loop, Executor& workers, const AsyncPolicy& policy, const EvalLimits& limits,
+               std::string_view expression, bool postfix)
+    : loop(loop), workers(workers), policy(policy), limits(limits), expression(expression), postfix(postfix) {}
+
+    // The jobs of a suspended evaluation point to it
+    Evaluation(const Evaluation&) = delete;
+    Evaluation& operator=(const Evaluation&) = delete;
+
+    /// @return True if the expression is short enough to complete inline.
+    bool await_ready() const noexcept { return expression.size() <= policy.inline_bytes; }
+
+    /// Offloads the expression or starts evaluating it in slices.
+    /// @return False if it completed in the first slice.
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    /// @return Num The value of the expression.
+    /// @throws The errors of eval_infix() and eval_postfix().
+    /// @throws LimitExceeded if the expression exceeds the limits.
+    Num await_resume();
+
+private:
+    /// Evaluates up to policy.yield_tokens tokens, after checking the time
+    /// and the CancelToken of the limits.
+    /// @return True if the expression is done or failed.
+    bool step();
+
+    /// Evaluates a slice on the loop, then yields or resumes the waiter.
+    void next_step();
+
+    Executor&               loop;
+    Executor&               workers;
+    AsyncPolicy             policy;
+    EvalLimits              limits;
+    std::string_view        expression;
+    bool                    postfix;
+    std::coroutine_handle<> waiter;
+    std::optional<Num>      result;
+    std::exception_ptr      error;
+
+    // State of an expression evaluated in slices
+    CharClasses           classes;
+    std::optional<Lexer>  lexer;
+    InfixReducer<Num>     reducer;
+    InfixGrammar          grammar;
+    std::optional<Budget> budget;     ///< started by the first slice
+};
+
+/// @brief Awaitable evaluation of Infix and Postfix expressions.
+///
+/// co_await calc.eval_async(expr) gives the value of eval_infix(expr), or
+/// rethrows its error, without blocking the thread the coroutine runs on
+/// for long. How depends on the length of the expression, see AsyncPolicy:
+/// - Short expressions are evaluated inline, by the Calculator of the
+///   thread, and the coroutine does not suspend.
+/// - Medium expressions are evaluated on the loop in slices of
+///   yield_tokens tokens. After each slice the evaluation goes to the back
+///   of the loop queue, so the other jobs of the loop run in between.
+/// - Long expressions are evaluated by a worker thread. The coroutine is
+///   resumed on the loop once the value is ready.
+///
+/// Every evaluation is bounded by the EvalLimits given to set_limits(),
+/// whichever way it runs, and fails with LimitExceeded like the Calculator.
+/// The time limit counts from the first slice, so it includes the time a
+/// sliced evaluation waits for its turn on the loop. A sliced evaluation
+/// reads the time and the CancelToken at the start of every slice, so a
+/// cancel() between two slices stops it at the next one.
+///
+/// The expression is not copied and must stay valid until the co_await
+/// completes. The loop must be the executor that runs the awaiting
+/// coroutines, so they are always resumed on their own thread.
+///
+/// Instantiated for the types that have a Numeric specialization: int,
+/// std::int64_t, __int128, double and Decimal.
+///
+/// @tparam Num Numeric type used for operands and results.
+///
+/// Example Usage:
+/// @code
+///   Executor loop, workers(4);
+///   AsyncCalculator<int> calc(loop, workers);
+///
+///   Task handle(std::string expression) {  // any coroutine type
+///       int value = co_await calc.eval_async(expression);
+///       ...
+///   }
+/// @endcode
+
+template <class Num = int>
+class AsyncCalculator {
+public:
+    /// @param loop Executor that runs the awaiting coroutines.
+    /// @param workers Executor with threads, for long expressions.
+    /// @param policy Lengths that choose how expressions are evaluated.
+    /// @throws std::invalid_argument if policy.yield_tokens is 0.
+    AsyncCalculator(Executor& loop, Executor& workers, AsyncPolicy policy = AsyncPolicy());
+
+    /// @param infix The Infix expression.
+    /// @return An awaitable giving the value of eval_infix(infix).
+    Evaluation<Num> eval_async(std::string_view infix) {
+        return Evaluation<Num>(loop, workers, policy, limits, infix, false);
+    }
+
+    /// @param postfix The Postfix expression.
+    /// @return An awaitable giving the value of eval_postfix(postfix).
+    Evaluation<Num> eval_postfix_async(std::string_view postfix) {
+        return Evaluation<Num>(loop, workers, policy, limits, postfix, true);
+    }
+
+    /// Bounds the cost of the evaluations started from now on.
+    /// @param limits The limits, EvalLimits() for none.
+    void set_limits(const EvalLimits& limits) { this->limits = limits; }
+
+private:
+    Executor&   loop;
+    Executor&   workers;
+    AsyncPolicy policy;
+    EvalLimits  limits;
+};
+
+#endif // ASYNC_EVAL_HPP
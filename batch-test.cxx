@@ -0,0 +1,179 @@
+/// @file batch-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the BatchEvaluator class of libpostfix: values of
+/// well formed expressions, the status of each kind of error and limit,
+/// and reuse of an evaluator across batches. Build with
+///
+///   make lib && g++ -std=gnu++20 batch-test.cxx libpostfix.a -pthread -lrt
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "batch_eval.hpp"  // check include guard
+#include "numeric.hpp"
+#include "postfix.hpp"
+
+// Test well formed expressions
+TEST_CASE("values", "[batch]") {
+    BatchEvaluator<int> evaluator;
+
+    SECTION("a batch gives the values of eval_infix()") {
+        std::vector<std::string> texts{"2 + 3 * 4", "( ( -500 + 400 ) * ( -300 - 200 ) / ( -100 / ( 0 + 100 ) ) )",
+                                       "7 % 3 - -2", "42", "( 1 )", "2147483647 + 1"};
+        std::vector<std::string_view> expressions(texts.begin(), texts.end());
+        std::vector<int> results(texts.size());
+        std::vector<EvalStatus> statuses(texts.size());
+
+        CHECK(evaluator.evaluate(expressions, results, statuses) == texts.size());
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            CHECK(statuses[i] == EvalStatus::OK);
+            CHECK(results[i] == eval_infix<int>(texts[i]));
+        }
+    }
+
+    SECTION("views into a larger buffer") {
+        std::string buffer = "1 + 2|3 * 4";
+        std::vector<std::string_view> expressions{std::string_view(buffer).substr(0, 5),
+                                                  std::string_view(buffer).substr(6)};
+        std::vector<int> results(2);
+        std::vector<EvalStatus> statuses(2);
+
+        evaluator.evaluate(expressions, results, statuses);
+        CHECK(results[0] == 3);
+        CHECK(results[1] == 12);
+    }
+
+    SECTION("other numeric types") {
+        BatchEvaluator<double> doubles;
+        BatchEvaluator<std::int64_t> wide;
+        EvalStatus status;
+
+        CHECK(doubles.evaluate("1 / 4", status) == 0.25);
+        CHECK(status == EvalStatus::OK);
+        CHECK(wide.evaluate("3000000000 * 2", status) == 6000000000LL);
+        CHECK(status == EvalStatus::OK);
+    }
+}
+
+// Test the status of each kind of error
+TEST_CASE("statuses", "[batch]") {
+    BatchEvaluator<int> evaluator;
+    EvalStatus status;
+
+    auto check = [&](const char* text, EvalStatus expected) {
+        CHECK(evaluator.evaluate(text, status) == 0);
+        CHECK(status == expected);
+    };
+
+    check("1 + x", EvalStatus::INVALID_CHARACTER);
+    check("1\t+ 2", EvalStatus::INVALID_CHARACTER);
+    check("", EvalStatus::MALFORMED);
+    check("1 +", EvalStatus::MALFORMED);
+    check("* 2", EvalStatus::MALFORMED);
+    check("1 2 +", EvalStatus::MALFORMED);
+    check("( 1 + 2", EvalStatus::MALFORMED);
+    check("1 + 2 )", EvalStatus::MALFORMED);
+    check("( )", EvalStatus::MALFORMED);
+    check("2 ( 3 )", EvalStatus::MALFORMED);
+    check("1 / 0", EvalStatus::DIVISION_BY_ZERO);
+    check("( 5 + 2 ) % ( 3 - 3 )", EvalStatus::DIVISION_BY_ZERO);
+    check("-2147483648 / -1", EvalStatus::OUT_OF_RANGE);
+    check("99999999999", EvalStatus::OUT_OF_RANGE);
+
+    CHECK(std::string(status_name(EvalStatus::DIVISION_BY_ZERO)) == "division by zero");
+}
+
+// Test the limits of each expression
+TEST_CASE("limits", "[batch]") {
+    CancelToken cancel;
+    EvalLimits limits;
+    limits.max_tokens = 600;
+    limits.max_depth = 3;
+    limits.max_stack = 200;
+    limits.cancel = &cancel;
+    BatchEvaluator<int> evaluator(limits);
+    EvalStatus status;
+
+    std::string deep = "( ( ( ( 1 ) ) ) )";
+    std::string chain = "1";
+    for (int i = 0; i < 300; ++i) {
+        chain += " - 1";
+    }
+    std::string rising = "1";
+    for (int i = 0; i < 250; ++i) {
+        rising += " + ( 1";
+    }
+    rising += std::string(250, ')');
+
+    CHECK(evaluator.evaluate("( ( ( 2 ) ) ) * 3", status) == 6);
+    CHECK(status == EvalStatus::OK);
+    CHECK(evaluator.evaluate(deep, status) == 0);
+    CHECK(status == EvalStatus::DEPTH_LIMIT);
+    CHECK(evaluator.evaluate(chain, status) == 0);
+    CHECK(status == EvalStatus::TOKEN_LIMIT);
+    CHECK(std::string(status_name(status)) == "token limit exceeded");
+
+    SECTION("stacks") {
+        limits.max_depth = EvalLimits::unlimited;
+        BatchEvaluator<int> nested(limits);
+        nested.evaluate(rising, status);
+        CHECK(status == EvalStatus::STACK_LIMIT);
+    }
+
+    SECTION("length, checked before the characters") {
+        limits.max_length = 9;
+        BatchEvaluator<int> bounded(limits);
+        CHECK(bounded.evaluate("1 + 2 * 3", status) == 7);
+        CHECK(status == EvalStatus::OK);
+        bounded.evaluate("1 + 2 * 30", status);
+        CHECK(status == EvalStatus::LENGTH_LIMIT);
+        bounded.evaluate(std::string(1 << 20, 'x'), status);  // not INVALID_CHARACTER
+        CHECK(status == EvalStatus::LENGTH_LIMIT);
+        CHECK(std::string(status_name(status)) == "length limit exceeded");
+    }
+
+    SECTION("cancellation") {
+        cancel.cancel();
+        CHECK(evaluator.evaluate("1 + 2", status) == 0);
+        CHECK(status == EvalStatus::CANCELLED);
+        cancel.reset();
+        CHECK(evaluator.evaluate("1 + 2", status) == 3);
+    }
+
+    SECTION("time") {
+        limits.max_tokens = EvalLimits::unlimited;
+        limits.max_time = std::chrono::nanoseconds(1);
+        BatchEvaluator<int> timed(limits);
+        timed.evaluate(chain, status);
+        CHECK(status == EvalStatus::TIME_LIMIT);
+    }
+}
+
+// Test reuse across batches
+TEST_CASE("reuse", "[batch]") {
+    BatchEvaluator<int> evaluator;
+    std::vector<std::string_view> expressions{"( 1 + 2", "1 / 0", "6 * 7", "1 2", "10 - 4"};
+    std::vector<int> results(expressions.size());
+    std::vector<EvalStatus> statuses(expressions.size());
+
+    SECTION("a failed expression leaves nothing behind") {
+        for (int round = 0; round < 3; ++round) {
+            CHECK(evaluator.evaluate(expressions, results, statuses) == 2);
+            CHECK(results == std::vector<int>{0, 0, 42, 0, 6});
+        }
+    }
+
+    SECTION("spans of different sizes are rejected") {
+        std::vector<int> short_results(2);
+        CHECK_THROWS_AS(evaluator.evaluate(expressions, short_results, statuses), std::invalid_argument);
+    }
+}
+
+/* EOF */
@@ -0,0 +1,144 @@
+/// @file batch_eval.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the BatchEvaluator class.
+
+#include <stdexcept>
+#include "alloc_track.hpp"
+#include "batch_eval.hpp"
+#include "lexer.hpp"
+#include "numeric.hpp"
+
+template <class Num>
+std::size_t BatchEvaluator<Num>::evaluate(std::span<const std::string_view> expressions,
+                                          std::span<Num> results, std::span<EvalStatus> statuses)
+{
+    if (results.size() != expressions.size() || statuses.size() != expressions.size())
+    {
+        throw std::invalid_argument("results and statuses must have one entry per expression");
+    }
+
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    std::size_t ok = 0;
+
+    for (std::size_t i = 0; i < expressions.size(); ++i)
+    {
+        results[i] = evaluate(expressions[i], statuses[i]);
+        ok += statuses[i] == EvalStatus::OK;
+    }
+
+    return ok;
+}
+
+template <class Num>
+Num BatchEvaluator<Num>::evaluate(std::string_view expression, EvalStatus& status)
+{
+    Num result = Num();
+
+    // Only the Numeric traits and the budget throw, the grammar is checked
+    // before the stacks are used
+    try
+    {
+        status = reduce(expression, result);
+    }
+    catch (const std::domain_error&)
+    {
+        status = EvalStatus::DIVISION_BY_ZERO;
+    }
+    catch (const std::overflow_error&)
+    {
+        status = EvalStatus::OUT_OF_RANGE;
+    }
+    catch (const std::out_of_range&)
+    {
+        status = EvalStatus::OUT_OF_RANGE;
+    }
+    catch (const std::invalid_argument&)
+    {
+        status = EvalStatus::MALFORMED;
+    }
+    catch (const LimitExceeded& e)
+    {
+        status = e.status();
+    }
+
+    if (status != EvalStatus::OK)
+    {
+        reducer.reset();
+        return Num();
+    }
+    return result;
+}
+
+template <class Num>
+EvalStatus BatchEvaluator<Num>::reduce(std::string_view expression, Num& result)
+{
+    Budget budget(limits, expression.size());
+    if (!classify(expression.data(), expression.size(), classes))
+    {
+        return EvalStatus::INVALID_CHARACTER;
+    }
+
+    Lexer lexer(expression.data(), classes);
+    bool operand = true;  // a number or '(' comes next
+    std::size_t depth = 0;
+
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next())
+    {
+        budget.token();
+        if (token.kind == Token::NUMBER)
+        {
+            if (!operand)
+            {
+                return EvalStatus::MALFORMED;
+            }
+            reducer.push_value(Numeric<Num>::parse(token.first, token.last));
+            budget.stack(reducer.value_depth());
+            operand = false;
+            continue;
+        }
+
+        char symbol = token.symbol();
+        if (symbol == '(')
+        {
+            if (!operand)
+            {
+                return EvalStatus::MALFORMED;
+            }
+            budget.depth(++depth);
+        }
+        else if (symbol == ')')
+        {
+            if (operand || depth == 0)
+            {
+                return EvalStatus::MALFORMED;
+            }
+            --depth;
+        }
+        else
+        {
+            if (operand)
+            {
+                return EvalStatus::MALFORMED;
+            }
+            operand = true;
+        }
+        reducer.push_operator(symbol);
+        budget.stack(reducer.operator_depth());
+    }
+
+    if (operand || depth != 0)
+    {
+        return EvalStatus::MALFORMED;
+    }
+
+    result = reducer.finish();
+    return EvalStatus::OK;
+}
+
+// Batch evaluators for the supported numeric types
+template class BatchEvaluator<int>;
+template class BatchEvaluator<std::int64_t>;
+template class BatchEvaluator<__int128>;
+template class BatchEvaluator<double>;
+template class BatchEvaluator<Decimal>;
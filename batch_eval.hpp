@@ -0,0 +1,87 @@
+/// @file batch_eval.hpp
+/// @author Etienne Bravo
+///
+/// @brief Evaluation of many Infix expressions per call, for programs that
+/// link libpostfix.
+
+#ifndef BATCH_EVAL_HPP
+#define BATCH_EVAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "calculator.hpp"
+#include "char_class.hpp"
+#include "eval_limits.hpp"
+#include "infix_reducer.hpp"
+
+/// @brief Evaluates batches of Infix expressions into caller owned arrays.
+///
+/// Gives the same values as eval_infix(), but reports errors through a
+/// status per expression instead of exceptions, so one bad expression does
+/// not stop the others. The expressions are checked as they are read: a
+/// number or '(' must follow an operator or '(', an operator or ')' must
+/// follow a number or ')', and the parentheses must balance. Integer sums,
+/// differences and products wrap around like in eval_infix(), through the
+/// Numeric traits.
+///
+/// The character bitmaps and the stacks are members, kept from one call
+/// to the next, so an evaluator reused for many batches does no per call
+/// setup. An evaluator is not thread safe, use one per thread.
+///
+/// Each expression can be bounded by EvalLimits. An expression over its
+/// limits stops at the token that exceeds them, with the status of the
+/// limit, and the other expressions of the batch still run.
+///
+/// Instantiated for the types that have a Numeric specialization: int,
+/// std::int64_t, __int128, double and Decimal.
+///
+/// @tparam Num Numeric type used for operands and results.
+///
+/// Example Usage:
+/// @code
+///   std::vector<std::string_view> expressions{"2 + 3 * 4", "1 / 0"};
+///   std::vector<int> results(2);
+///   std::vector<EvalStatus> statuses(2);
+///
+///   BatchEvaluator<int> evaluator;
+///   evaluator.evaluate(expressions, results, statuses);
+///   // results[0] == 14, statuses[1] == EvalStatus::DIVISION_BY_ZERO
+/// @endcode
+
+template <class Num = int>
+class BatchEvaluator {
+public:
+    /// Reserves the stacks like a Calculator.
+    /// @param limits Limits of every expression, none by default.
+    explicit BatchEvaluator(const EvalLimits& limits = EvalLimits()) : limits(limits) {
+        reducer.reserve(Calculator<Num>::default_depth);
+    }
+
+    /// Evaluates expressions[i] into results[i] and statuses[i]. The result
+    /// of an expression that fails is Num().
+    /// @param expressions Infix expressions.
+    /// @param results Receives the values, as many as expressions.
+    /// @param statuses Receives the statuses, as many as expressions.
+    /// @return Number of expressions evaluated with EvalStatus::OK.
+    /// @throws std::invalid_argument if the spans have different sizes.
+    std::size_t evaluate(std::span<const std::string_view> expressions,
+                         std::span<Num> results, std::span<EvalStatus> statuses);
+
+    /// Evaluates one expression.
+    /// @param expression Infix expression.
+    /// @param status Receives the status.
+    /// @return Num The value of the expression, Num() if it fails.
+    Num evaluate(std::string_view expression, EvalStatus& status);
+
+private:
+    /// Evaluates one expression, throwing the errors of the Numeric traits.
+    EvalStatus reduce(std::string_view expression, Num& result);
+
+    CharClasses       classes;
+    InfixReducer<Num> reducer;
+    EvalLimits        limits;
+};
+
+#endif // BATCH_EVAL_HPP
@@ -0,0 +1,489 @@
+/// @file batch_reader.cpp
+/// @author Etienne Bravo
+///
+/// @brief io_uring and thread pool backends of the BatchReader class.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "batch_reader.hpp"
+
+#if __has_include(<linux/io_uring.h>)
+#define BATCH_READER_URING 1
+#include <linux/io_uring.h>
+#endif
+
+namespace {
+
+/// Size of the first read of a file, doubled while the file is larger.
+const std::size_t initial_read = 64 * 1024;
+
+/// Set by BatchReader::emulate_old_kernel().
+std::atomic<bool> old_kernel{false};
+
+/// @return True if path is the output of a batch, FILE.out.
+bool is_output(const std::string& path)
+{
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".out") == 0;
+}
+
+/// Reads a whole file with blocking calls.
+/// @return 0 or the errno of the call that failed.
+int read_file(const std::string& path, std::string& contents)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno;
+    }
+
+    struct stat info;
+    std::size_t capacity = initial_read;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        capacity = static_cast<std::size_t>(info.st_size) + 1;  // +1 to see EOF
+    }
+
+    std::size_t length = 0;
+    contents.resize(capacity);
+    for (;;)
+    {
+        ssize_t got = ::pread(fd, &contents[length], contents.size() - length, length);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0)
+        {
+            int error = errno;
+            ::close(fd);
+            return error;
+        }
+        if (got == 0)
+        {
+            break;
+        }
+        length += static_cast<std::size_t>(got);
+        if (length == contents.size())
+        {
+            contents.resize(contents.size() * 2);
+        }
+    }
+
+    contents.resize(length);
+    ::close(fd);
+    return 0;
+}
+
+/// Pool of threads doing blocking reads, used when io_uring is unavailable.
+class ThreadBackend : public ReaderBackend {
+public:
+    ThreadBackend(std::vector<std::string> paths, unsigned depth)
+    : paths(std::move(paths)), next_index(0), delivered(0)
+    {
+        unsigned threads = std::max(2u, std::min(depth, std::thread::hardware_concurrency()));
+        threads = std::min<unsigned>(threads, std::max<std::size_t>(this->paths.size(), 1));
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadBackend() override
+    {
+        next_index = paths.size();  // stop claiming files
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool next(FileData& file) override
+    {
+        if (delivered == paths.size())
+        {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ready_cv.wait(lock, [this] { return !ready.empty(); });
+        file = std::move(ready.front());
+        ready.pop_front();
+        ++delivered;
+        return true;
+    }
+
+    const char* name() const override { return "threads"; }
+
+private:
+    void work()
+    {
+        for (;;)
+        {
+            std::size_t index = next_index.fetch_add(1);
+            if (index >= paths.size())
+            {
+                return;
+            }
+
+            FileData file{index, paths[index], std::string(), 0};
+            file.error = read_file(file.path, file.contents);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(std::move(file));
+            ready_cv.notify_one();
+        }
+    }
+
+    std::vector<std::string> paths;
+    std::atomic<std::size_t> next_index;  ///< next file to claim
+    std::size_t              delivered;   ///< files returned by next()
+    std::deque<FileData>     ready;       ///< files read but not delivered
+    std::mutex               mutex;       ///< protects ready
+    std::condition_variable  ready_cv;
+    std::vector<std::thread> workers;
+};
+
+#ifdef BATCH_READER_URING
+
+/// Reads files through an io_uring instance driven by the calling thread.
+/// Every file goes through an OPENAT and one or more READ operations, at
+/// most one operation per file is in flight. The rings are used with the
+/// raw system calls, no liburing needed.
+class UringBackend : public ReaderBackend {
+public:
+    UringBackend(std::vector<std::string> paths, unsigned depth)
+    : paths(std::move(paths)), depth(depth), ring_fd(-1), next_open(0), active(0),
+      delivered(0), local_tail(0), unsubmitted(0), open_opcode(IORING_OP_OPENAT)
+    {
+        // An opcode the kernel does not know fails with -EINVAL, like OPENAT before 5.6
+        if (old_kernel.load(std::memory_order_relaxed))
+        {
+            open_opcode = IORING_OP_LAST;
+        }
+
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+        if (ring_fd < 0)
+        {
+            return;
+        }
+
+        sq_length = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_length = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        sqes_length = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        sq_ring = ::mmap(nullptr, sq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQ_RING);
+        cq_ring = ::mmap(nullptr, cq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_CQ_RING);
+        sqe_array = ::mmap(nullptr, sqes_length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_array == MAP_FAILED)
+        {
+            release();
+            return;
+        }
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        local_tail = *sq_tail;
+        sq_mask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_index = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes     = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqes     = static_cast<struct io_uring_sqe*>(sqe_array);
+
+        files.resize(this->paths.size());
+        fds.assign(this->paths.size(), -1);
+        lengths.assign(this->paths.size(), 0);
+    }
+
+    ~UringBackend() override
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+        release();
+    }
+
+    /// @return True if the ring was set up.
+    bool ready() const { return ring_fd >= 0; }
+
+    bool next(FileData& file) override
+    {
+        while (done.empty())
+        {
+            if (delivered == paths.size())
+            {
+                return false;
+            }
+            pump(true);
+        }
+
+        file = std::move(done.front());
+        done.pop_front();
+        ++delivered;
+
+        // Keep the ring busy while the caller works on this file
+        pump(false);
+        return true;
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+private:
+    enum Operation { OPEN = 0, READ = 1 };
+
+    void release()
+    {
+        if (sq_ring != nullptr && sq_ring != MAP_FAILED) ::munmap(sq_ring, sq_length);
+        if (cq_ring != nullptr && cq_ring != MAP_FAILED) ::munmap(cq_ring, cq_length);
+        if (sqe_array != nullptr && sqe_array != MAP_FAILED) ::munmap(sqe_array, sqes_length);
+        sq_ring = cq_ring = sqe_array = nullptr;
+        if (ring_fd >= 0)
+        {
+            ::close(ring_fd);
+            ring_fd = -1;
+        }
+    }
+
+    /// @return A cleared submission entry at the tail of the ring.
+    struct io_uring_sqe* get_sqe()
+    {
+        unsigned slot = local_tail++ & sq_mask;
+        struct io_uring_sqe* sqe = &sqes[slot];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_index[slot] = slot;
+        ++unsubmitted;
+        return sqe;
+    }
+
+    void start_open(std::size_t index)
+    {
+        files[index] = FileData{index, paths[index], std::string(), 0};
+
+        struct io_uring_sqe* sqe = get_sqe();
+        sqe->opcode     = open_opcode;
+        sqe->fd         = AT_FDCWD;
+        sqe->addr       = reinterpret_cast<unsigned long>(paths[index].c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        sqe->user_data  = (index << 1) | OPEN;
+        ++active;
+    }
+
+    void start_read(std::size_t index)
+    {
+        std::string& contents = files[index].contents;
+        if (contents.size() == lengths[index])
+        {
+            contents.resize(std::max(initial_read, contents.size() * 2));
+        }
+
+        struct io_uring_sqe* sqe = get_sqe();
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = fds[index];
+        sqe->addr      = reinterpret_cast<unsigned long>(&contents[lengths[index]]);
+        sqe->len       = static_cast<unsigned>(contents.size() - lengths[index]);
+        sqe->off       = lengths[index];
+        sqe->user_data = (index << 1) | READ;
+    }
+
+    void finish(std::size_t index, int error)
+    {
+        if (fds[index] >= 0)
+        {
+            ::close(fds[index]);
+            fds[index] = -1;
+        }
+        files[index].error = error;
+        files[index].contents.resize(error == 0 ? lengths[index] : 0);
+        done.push_back(std::move(files[index]));
+        --active;
+    }
+
+    void complete(const struct io_uring_cqe& cqe)
+    {
+        std::size_t index = cqe.user_data >> 1;
+
+        // Kernels older than 5.6 have io_uring but not these operations
+        if (cqe.res == -EINVAL && (cqe.user_data & 1) == OPEN)
+        {
+            int error = read_file(paths[index], files[index].contents);
+            lengths[index] = files[index].contents.size();
+            finish(index, error);
+        }
+        else if (cqe.res < 0)
+        {
+            finish(index, -cqe.res);
+        }
+        else if ((cqe.user_data & 1) == OPEN)
+        {
+            fds[index] = cqe.res;
+            start_read(index);
+        }
+        else
+        {
+            // A short read of a regular file means the end was reached
+            std::size_t requested = files[index].contents.size() - lengths[index];
+            lengths[index] += static_cast<std::size_t>(cqe.res);
+            if (cqe.res == 0 || static_cast<std::size_t>(cqe.res) < requested)
+            {
+                finish(index, 0);
+            }
+            else
+            {
+                start_read(index);
+            }
+        }
+    }
+
+    /// Starts new files, submits the queued entries and reaps completions.
+    /// @param wait Block until at least one operation completes.
+    void pump(bool wait)
+    {
+        while (active < depth && next_open < paths.size())
+        {
+            start_open(next_open++);
+        }
+
+        __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+        long submitted = ::syscall(__NR_io_uring_enter, ring_fd, unsubmitted, wait ? 1 : 0,
+                                   flags, nullptr, 0);
+        if (submitted > 0)
+        {
+            unsubmitted -= static_cast<unsigned>(submitted);
+        }
+
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            complete(cqes[head & cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    std::vector<std::string> paths;
+    unsigned                 depth;        ///< files in flight at most
+    int                      ring_fd;
+    std::size_t              next_open;    ///< next file to open
+    unsigned                 active;       ///< files opened but not finished
+    std::size_t              delivered;    ///< files returned by next()
+    unsigned                 local_tail;   ///< tail including unpublished entries
+    unsigned                 unsubmitted;  ///< entries not consumed by the kernel
+    std::uint8_t             open_opcode;  ///< IORING_OP_OPENAT, unless emulating an old kernel
+
+    std::vector<FileData>    files;        ///< files being read
+    std::vector<int>         fds;          ///< descriptors of the open files
+    std::vector<std::size_t> lengths;      ///< bytes read so far
+    std::deque<FileData>     done;         ///< files read but not delivered
+
+    void*                 sq_ring = nullptr;
+    void*                 cq_ring = nullptr;
+    void*                 sqe_array = nullptr;
+    std::size_t           sq_length = 0;
+    std::size_t           cq_length = 0;
+    std::size_t           sqes_length = 0;
+    unsigned*             sq_tail = nullptr;
+    unsigned              sq_mask = 0;
+    unsigned*             sq_index = nullptr;
+    unsigned*             cq_head = nullptr;
+    unsigned*             cq_tail = nullptr;
+    unsigned              cq_mask = 0;
+    struct io_uring_cqe*  cqes = nullptr;
+    struct io_uring_sqe*  sqes = nullptr;
+};
+
+#endif // BATCH_READER_URING
+
+} // namespace
+
+void BatchReader::emulate_old_kernel(bool on)
+{
+    old_kernel.store(on, std::memory_order_relaxed);
+}
+
+BatchReader::BatchReader(std::vector<std::string> paths, bool use_uring, unsigned depth)
+{
+#ifdef BATCH_READER_URING
+    if (use_uring)
+    {
+        std::unique_ptr<UringBackend> uring(new UringBackend(paths, depth));
+        if (uring->ready())
+        {
+            backend = std::move(uring);
+            return;
+        }
+    }
+#endif
+    backend.reset(new ThreadBackend(std::move(paths), depth));
+}
+
+std::vector<std::string> expand_inputs(const std::vector<std::string>& args)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+
+    for (const std::string& arg : args)
+    {
+        std::error_code error;
+        if (fs::is_directory(arg, error))
+        {
+            std::vector<std::string> entries;
+            for (const fs::directory_entry& entry : fs::directory_iterator(arg, error))
+            {
+                if (entry.is_regular_file(error) && !is_output(entry.path().string()))
+                {
+                    entries.push_back(entry.path().string());
+                }
+            }
+            std::sort(entries.begin(), entries.end());
+            files.insert(files.end(), entries.begin(), entries.end());
+        }
+        else if (arg.find_first_of("*?[") != std::string::npos)
+        {
+            glob_t matches;
+            if (::glob(arg.c_str(), 0, nullptr, &matches) == 0)
+            {
+                for (std::size_t i = 0; i < matches.gl_pathc; ++i)
+                {
+                    if (!is_output(matches.gl_pathv[i]))
+                    {
+                        files.push_back(matches.gl_pathv[i]);
+                    }
+                }
+            }
+            ::globfree(&matches);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    return files;
+}
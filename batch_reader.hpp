@@ -0,0 +1,91 @@
+/// @file batch_reader.hpp
+/// @author Etienne Bravo
+///
+/// @brief Asynchronous reading of many input files for batch evaluation.
+
+#ifndef BATCH_READER_HPP
+#define BATCH_READER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Contents of one input file, as delivered by BatchReader.
+struct FileData {
+    std::size_t index;     ///< position of the file in the list given to BatchReader
+    std::string path;      ///< path of the file
+    std::string contents;  ///< whole contents of the file
+    int         error;     ///< errno of a failed open or read, 0 on success
+};
+
+/// Interface of the I/O backends used by BatchReader.
+class ReaderBackend {
+public:
+    virtual ~ReaderBackend() = default;
+
+    /// Waits for the next file to be read.
+    /// @param file Receives the file.
+    /// @return False once every file has been delivered.
+    virtual bool next(FileData& file) = 0;
+
+    /// @return Name of the backend.
+    virtual const char* name() const = 0;
+};
+
+/// @brief Reads a list of files while the caller evaluates the ones that are
+/// already in memory.
+///
+/// Opens and reads are issued through io_uring, up to depth files at a
+/// time, so the latency of one file is hidden behind the reads of the
+/// others and behind the evaluation done between calls to next(). If
+/// io_uring is not available (old kernel, seccomp filter, or not Linux),
+/// a pool of threads doing blocking open() and pread() calls is used
+/// instead. Files are delivered in the order their reads complete, use
+/// FileData::index to find their position in the list.
+///
+/// Example Usage:
+/// @code
+///   BatchReader reader({"a.txt", "b.txt"});
+///   FileData file;
+///   while (reader.next(file)) { ... }
+/// @endcode
+
+class BatchReader {
+public:
+    /// Starts reading the files.
+    /// @param paths Files to read.
+    /// @param use_uring Try io_uring before falling back to threads.
+    /// @param depth Number of files read at the same time.
+    explicit BatchReader(std::vector<std::string> paths, bool use_uring = true,
+                         unsigned depth = 32);
+
+    /// Waits for the next file to be read.
+    /// @param file Receives the file.
+    /// @return False once every file has been delivered.
+    bool next(FileData& file) { return backend->next(file); }
+
+    /// @return "io_uring" or "threads".
+    const char* backend_name() const { return backend->name(); }
+
+    /// Makes io_uring reject the opens of the readers created afterwards,
+    /// as kernels older than 5.6 do, so their fallback can be tested.
+    /// @param on True to reject, false for the normal opens.
+    static void emulate_old_kernel(bool on);
+
+private:
+    std::unique_ptr<ReaderBackend> backend;
+};
+
+/// @brief Expands input arguments into a list of files.
+///
+/// A directory is replaced by the regular files it contains, sorted by name.
+/// An argument with '*', '?' or '[' that the shell did not expand is matched
+/// with glob(). Files ending in ".out", the outputs of an earlier batch, are
+/// left out of both. Other arguments are kept as they are.
+///
+/// @param args Paths, directories and patterns.
+/// @return The files, in argument order.
+std::vector<std::string> expand_inputs(const std::vector<std::string>& args);
+
+#endif // BATCH_READER_HPP
@@ -0,0 +1,143 @@
+/// @file calculator-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the Calculator class of libpostfix: the results
+/// match the free functions, a failed expression leaves nothing behind, and
+/// a warm calculator does not allocate. Build with
+///
+///   make lib && g++ -std=gnu++20 calculator-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "alloc_track.hpp"
+#include "calculator.hpp"  // check include guard
+#include "numeric.hpp"
+#include "postfix.hpp"
+
+// Test the results
+TEST_CASE("results", "[calculator]") {
+    Calculator<int> calculator;
+    std::string infix = "( ( -500 + 400 ) * ( -300 - 200 ) / ( -100 / ( 0 + 100 ) ) )";
+
+    SECTION("the same results as the free functions") {
+        CHECK(calculator.to_postfix(infix) == infix2postfix(infix));
+        CHECK(calculator.eval_postfix(calculator.to_postfix(infix)) == -50000);
+        CHECK(calculator.eval_infix(infix) == eval_infix<int>(infix));
+        CHECK(calculator.eval_infix("2 + 3 * 4") == 14);
+    }
+
+    SECTION("views into a larger buffer") {
+        std::string buffer = "1 + 2|3 * 4";
+        CHECK(calculator.eval_infix(std::string_view(buffer).substr(0, 5)) == 3);
+        CHECK(calculator.to_postfix(std::string_view(buffer).substr(6)) == "3 4 * ");
+    }
+
+    SECTION("other numeric types") {
+        CHECK(Calculator<double>().eval_infix("1 / 4") == 0.25);
+        CHECK(Calculator<std::int64_t>().eval_postfix("3000000000 2 *") == 6000000000LL);
+    }
+
+    SECTION("deeper than the reserved depth") {
+        Calculator<int> shallow(2);
+        CHECK(shallow.eval_infix("1 + ( 2 * ( 3 + ( 4 * ( 5 + 6 ) ) ) )") == 95);
+        CHECK(shallow.eval_infix("7 - 2") == 5);
+    }
+}
+
+// Test reuse after errors
+TEST_CASE("reuse", "[calculator]") {
+    Calculator<int> calculator;
+
+    CHECK_THROWS_AS(calculator.eval_infix("( 5 + 2 ) * ( 1 / 0 )"), std::domain_error);
+    CHECK(calculator.eval_infix("6 * 7") == 42);
+    CHECK_THROWS_AS(calculator.eval_postfix("1 2 3 0 / +"), std::domain_error);
+    CHECK(calculator.eval_postfix("10 4 -") == 6);
+    CHECK(&Calculator<int>::local() == &Calculator<int>::local());
+}
+
+// Test that malformed Infix expressions are rejected, not half evaluated
+TEST_CASE("malformed infix", "[calculator]") {
+    Calculator<int> calculator;
+
+    for (const char* infix : {"", "1 2", "1 +", "+ 1", "( 1 + 2", "1 + 2 )", ") 1 (", "( )", "1 ( 2 )", "( 1 ) 2",
+                              "1 + * 2", "( ( 3 ) ) )"}) {
+        INFO(infix);
+        CHECK_THROWS_WITH(calculator.eval_infix(infix), "malformed expression");
+        CHECK(calculator.eval_infix("( 1 + 2 ) * 3") == 9);
+    }
+    CHECK(calculator.eval_infix("( ( 3 ) )") == 3);
+    CHECK(calculator.eval_infix("-4 - -2") == -2);
+}
+
+// Test the limits
+TEST_CASE("limits", "[calculator]") {
+    Calculator<int> calculator;
+    EvalLimits limits;
+    limits.max_depth = 2;
+    limits.max_stack = 4;
+    calculator.set_limits(limits);
+
+    auto status = [&](auto evaluate) {
+        try {
+            evaluate();
+        } catch (const LimitExceeded& e) {
+            return e.status();
+        }
+        return EvalStatus::OK;
+    };
+
+    CHECK(status([&] { calculator.eval_infix("( ( 1 + 2 ) )"); }) == EvalStatus::OK);
+    CHECK(status([&] { calculator.eval_infix("( ( ( 1 ) ) )"); }) == EvalStatus::DEPTH_LIMIT);
+    CHECK(status([&] { calculator.to_postfix("( ( ( 1 ) ) )"); }) == EvalStatus::DEPTH_LIMIT);
+    CHECK(status([&] { calculator.eval_postfix("1 2 3 4 5 + + + +"); }) == EvalStatus::STACK_LIMIT);
+    CHECK(status([&] { calculator.eval_infix("1 + 2 * ( 3 - 4 * ( 5 ) )"); }) == EvalStatus::STACK_LIMIT);
+    CHECK(calculator.eval_infix("1 + 2 * 3") == 7);
+
+    // Too long, rejected before the characters are looked at
+    limits.max_length = 9;
+    calculator.set_limits(limits);
+    std::string garbage(1 << 20, 'x');
+    CHECK(calculator.eval_infix("1 + 2 * 3") == 7);
+    CHECK(status([&] { calculator.eval_infix("1 + 2 * 30"); }) == EvalStatus::LENGTH_LIMIT);
+    CHECK(status([&] { calculator.eval_infix(garbage); }) == EvalStatus::LENGTH_LIMIT);
+    CHECK(status([&] { calculator.to_postfix(garbage); }) == EvalStatus::LENGTH_LIMIT);
+    CHECK(status([&] { calculator.eval_postfix(garbage); }) == EvalStatus::LENGTH_LIMIT);
+    limits.max_length = EvalLimits::unlimited;
+
+    CancelToken cancel;
+    limits.cancel = &cancel;
+    calculator.set_limits(limits);
+    cancel.cancel();
+    CHECK(status([&] { calculator.eval_infix("1 + 2"); }) == EvalStatus::CANCELLED);
+
+    calculator.set_limits(EvalLimits());
+    CHECK(calculator.eval_infix("( ( ( 1 ) ) ) + 1") == 2);
+}
+
+// Test that a warm calculator does not allocate
+TEST_CASE("no allocations once warm", "[calculator]") {
+    Calculator<int> calculator;
+    std::string infix = "( ( -500 + 400 ) * ( -300 - 200 ) / ( -100 / ( 0 + 100 ) ) )";
+    calculator.eval_postfix(calculator.to_postfix(infix));
+    calculator.eval_infix(infix);
+
+    alloc_track::enable();
+    alloc_track::Snapshot convert = alloc_track::phase(alloc_track::CONVERT);
+    alloc_track::Snapshot evaluate = alloc_track::phase(alloc_track::EVALUATE);
+    for (int round = 0; round < 100; ++round) {
+        calculator.eval_postfix(calculator.to_postfix(infix));
+        calculator.eval_infix(infix);
+    }
+    alloc_track::enable(false);
+
+    CHECK(alloc_track::phase(alloc_track::CONVERT).allocations == convert.allocations);
+    CHECK(alloc_track::phase(alloc_track::EVALUATE).allocations == evaluate.allocations);
+    CHECK(alloc_track::phase(alloc_track::EVALUATE).frees == evaluate.frees);
+}
+
+/* EOF */
@@ -0,0 +1,207 @@
+/// @file calculator.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the Calculator class: the Infix to Postfix
+/// conversion and the Postfix and single pass Infix evaluators.
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include "alloc_track.hpp"
+#include "calculator.hpp"
+#include "lexer.hpp"
+#include "numeric.hpp"
+#include "postfix.hpp"
+#include "trace.hpp"
+
+template <class Num>
+Calculator<Num>::Calculator(std::size_t depth)
+{
+    operators.reserve(depth);
+    values.reserve(depth);
+    reducer.reserve(depth);
+}
+
+template <class Num>
+std::string_view Calculator<Num>::to_postfix(std::string_view infix)
+{
+    alloc_track::PhaseScope phase(alloc_track::CONVERT);
+    trace::Span span(trace::CONVERT);
+    reset();
+    output.clear();
+    Budget budget(limits, infix.size());
+    std::size_t depth = 0;
+
+    classify(infix.data(), infix.size(), classes);
+    Lexer lexer(infix.data(), classes);
+
+    // populate string
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next())
+    {
+        budget.token();
+
+        // Numbers and negative numbers
+        if (token.kind == Token::NUMBER)
+        {
+            output.append(token.first, token.last);
+            output += ' ';
+        }
+
+        // Open parenthesis
+        else if (token.symbol() == '(')
+        {
+            budget.depth(++depth);
+            operators.push('(');
+            budget.stack(operators.size());
+        }
+
+        // If close parenthesis
+        else if (token.symbol() == ')')
+        {
+            while (!operators.empty() && operators.top() != '(')
+            {
+                output += operators.top();
+                output += ' ';
+                operators.pop();
+            }
+            operators.pop();
+            depth -= depth > 0;
+        }
+
+        // If operator is found
+        else
+        {
+            while (!operators.empty() && precedence(token.symbol()) <= precedence(operators.top()))
+            {
+                output += operators.top();
+                output += ' ';
+                operators.pop();
+            }
+            operators.push(token.symbol());
+            budget.stack(operators.size());
+        }
+    }
+
+    // clear the stack when input ends
+    while (!operators.empty())
+    {
+        output += operators.top();
+        output += ' ';
+        operators.pop();
+    }
+
+    return output;
+}
+
+template <class Num>
+Num Calculator<Num>::eval_postfix(std::string_view postfix)
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    trace::Span span(trace::EVALUATE);
+    reset();
+    Budget budget(limits, postfix.size());
+
+    classify(postfix.data(), postfix.size(), classes);
+    Lexer lexer(postfix.data(), classes);
+
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next()) {
+        budget.token();
+        if (token.kind == Token::NUMBER) {
+            values.push(Numeric<Num>::parse(token.first, token.last));
+            budget.stack(values.size());
+        } else {
+            if (values.size() < 2) {
+                throw std::invalid_argument(status_name(EvalStatus::MALFORMED));
+            }
+            Num operand1 = values.top();
+            values.pop();
+            Num operand2 = values.top();
+            values.pop();
+
+            switch (token.symbol()) {
+                case '+':
+                    values.push(Numeric<Num>::add(operand2, operand1));
+                    break;
+                case '-':
+                    values.push(Numeric<Num>::subtract(operand2, operand1));
+                    break;
+                case '*':
+                    values.push(Numeric<Num>::multiply(operand2, operand1));
+                    break;
+                case '/':
+                    values.push(Numeric<Num>::divide(operand2, operand1));
+                    break;
+                case '%':
+                    values.push(Numeric<Num>::remainder(operand2, operand1));
+                    break;
+                default:
+                    std::cerr << "Unknown operator: " << token.symbol() << std::endl;
+                    break;
+            }
+        }
+    }
+
+    // Operands left over, or none at all
+    if (values.size() != 1) {
+        throw std::invalid_argument(status_name(EvalStatus::MALFORMED));
+    }
+    return values.top();
+}
+
+template <class Num>
+Num Calculator<Num>::eval_infix(std::string_view infix)
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    trace::Span span(trace::EVALUATE);
+    reset();
+    Budget budget(limits, infix.size());
+
+    classify(infix.data(), infix.size(), classes);
+    Lexer lexer(infix.data(), classes);
+
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next())
+    {
+        budget.token();
+        if (token.kind == Token::NUMBER)
+        {
+            grammar.value();
+            reducer.push_value(Numeric<Num>::parse(token.first, token.last));
+            budget.stack(reducer.value_depth());
+        }
+        else
+        {
+            char op = token.symbol();
+            grammar.symbol(op);
+            budget.depth(grammar.open());
+            reducer.push_operator(op);
+            budget.stack(reducer.operator_depth());
+        }
+    }
+
+    // Values left over and unmatched parentheses
+    grammar.finish();
+    return reducer.finish();
+}
+
+template <class Num>
+void Calculator<Num>::reset()
+{
+    operators.clear();
+    values.clear();
+    reducer.reset();
+    grammar.reset();
+}
+
+template <class Num>
+Calculator<Num>& Calculator<Num>::local()
+{
+    static thread_local Calculator calculator;
+    return calculator;
+}
+
+// Calculators for the supported numeric types
+template class Calculator<int>;
+template class Calculator<std::int64_t>;
+template class Calculator<__int128>;
+template class Calculator<double>;
+template class Calculator<Decimal>;
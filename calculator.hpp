@@ -0,0 +1,106 @@
+/// @file calculator.hpp
+/// @author Etienne Bravo
+///
+/// @brief Calculator context that keeps its stacks and buffers from one
+/// expression to the next.
+
+#ifndef CALCULATOR_HPP
+#define CALCULATOR_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "Stack.hpp"
+#include "char_class.hpp"
+#include "eval_limits.hpp"
+#include "infix_reducer.hpp"
+
+/// @brief Converts and evaluates expressions without allocating once warm.
+///
+/// infix2postfix(), eval_postfix() and eval_infix() each need an operator
+/// or value stack, the character bitmaps of the Lexer and, for the
+/// conversion, an output string. A Calculator owns all of them. The stacks
+/// are reserved when it is constructed and keep their nodes when emptied,
+/// the bitmaps and the output string keep their capacity, so a Calculator
+/// used for many lines only allocates for a line longer or more deeply
+/// nested than all the lines before it.
+///
+/// The free functions of postfix.hpp use the Calculator of the calling
+/// thread, see local(). A Calculator is not thread safe.
+///
+/// Every conversion and evaluation is bounded by the EvalLimits given to
+/// set_limits(), none by default. An expression over its limits throws
+/// LimitExceeded at the token that exceeds them.
+///
+/// Instantiated for the types that have a Numeric specialization: int,
+/// std::int64_t, __int128, double and Decimal.
+///
+/// @tparam Num Numeric type used for operands and results.
+///
+/// Example Usage:
+/// @code
+///   Calculator<int> calculator;
+///   std::string_view postfix = calculator.to_postfix("2 + 3 * 4");  // "2 3 4 * + "
+///   int result = calculator.eval_postfix(postfix);                  // 14
+///   result = calculator.eval_infix("( 1 + 2 ) * 3");                // 9
+/// @endcode
+
+template <class Num = int>
+class Calculator {
+public:
+    /// Reserves the stacks for expressions nested up to depth.
+    /// @param depth Number of elements to keep storage for, on each stack.
+    explicit Calculator(std::size_t depth = default_depth);
+
+    /// Converts an Infix expression to Postfix, like infix2postfix().
+    /// @param infix The Infix expression.
+    /// @return The Postfix expression, valid until the next call.
+    /// @throws LimitExceeded if the expression exceeds the limits.
+    std::string_view to_postfix(std::string_view infix);
+
+    /// Evaluates a Postfix expression, like eval_postfix().
+    /// @param postfix The Postfix expression, may be the view returned by
+    /// to_postfix().
+    /// @return Num The value of the expression.
+    /// @throws std::invalid_argument if an operator has fewer than two
+    /// operands, or if operands are left over.
+    /// @throws LimitExceeded if the expression exceeds the limits.
+    Num eval_postfix(std::string_view postfix);
+
+    /// Evaluates an Infix expression in a single pass, like eval_infix().
+    /// @param infix The Infix expression.
+    /// @return Num The value of the expression.
+    /// @throws std::invalid_argument if operands and operators do not
+    /// alternate or the parentheses are unbalanced.
+    /// @throws LimitExceeded if the expression exceeds the limits.
+    Num eval_infix(std::string_view infix);
+
+    /// Bounds the cost of the next expressions.
+    /// @param limits The limits, EvalLimits() for none.
+    void set_limits(const EvalLimits& limits) { this->limits = limits; }
+
+    /// @return The limits of the next expressions.
+    const EvalLimits& current_limits() const { return limits; }
+
+    /// Discards what an expression that failed left on the stacks. The
+    /// storage is kept. Called at the start of every conversion and
+    /// evaluation.
+    void reset();
+
+    /// @return The Calculator of the calling thread, constructed on first use.
+    static Calculator& local();
+
+    /// Depth reserved by default, deeper expressions grow the stacks once.
+    static const std::size_t default_depth = 64;
+
+private:
+    CharClasses       classes;    ///< bitmaps of the current expression
+    Stack<char>       operators;  ///< operators of to_postfix()
+    Stack<Num>        values;     ///< operands of eval_postfix()
+    InfixReducer<Num> reducer;    ///< stacks of eval_infix()
+    InfixGrammar      grammar;    ///< order of the tokens of eval_infix()
+    std::string       output;     ///< result of to_postfix()
+    EvalLimits        limits;     ///< limits of every expression
+};
+
+#endif // CALCULATOR_HPP
@@ -0,0 +1,236 @@
+/// @file char_class.cpp
+/// @author Etienne Bravo
+///
+/// @brief Scalar, SSE4.2 and AVX2 classification kernels and the runtime
+/// dispatch between them.
+
+#include <cstring>
+#include "char_class.hpp"
+#include "trace.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHAR_CLASS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/// Bitmaps of one 64 byte block.
+struct BlockMasks {
+    std::uint64_t digit;
+    std::uint64_t op;
+    std::uint64_t paren;
+    std::uint64_t space;
+    std::uint64_t invalid;
+};
+
+/// A kernel classifies one block of 64 readable bytes.
+using Kernel = void (*)(const char* block, BlockMasks& masks);
+
+// Class flags of the scalar lookup table
+enum : unsigned char {
+    DIGIT   = 1,
+    OP      = 2,
+    PAREN   = 4,
+    BLANK   = 8,   // ' ', the only whitespace accepted as valid
+    SPACE   = 16,  // other whitespace
+};
+
+struct ClassTable {
+    unsigned char flags[256];
+
+    ClassTable() : flags() {
+        for (char c = '0'; c <= '9'; ++c) {
+            flags[static_cast<unsigned char>(c)] = DIGIT;
+        }
+        for (char c : {'+', '-', '*', '/', '%'}) {
+            flags[static_cast<unsigned char>(c)] = OP;
+        }
+        flags[static_cast<unsigned char>('(')] = PAREN;
+        flags[static_cast<unsigned char>(')')] = PAREN;
+        flags[static_cast<unsigned char>(' ')] = BLANK;
+        for (char c : {'\t', '\n', '\v', '\f', '\r'}) {
+            flags[static_cast<unsigned char>(c)] = SPACE;
+        }
+    }
+};
+
+const ClassTable table;
+
+void classify_scalar(const char* block, BlockMasks& masks) {
+    masks = BlockMasks{};
+    for (unsigned i = 0; i < 64; ++i) {
+        unsigned char flags = table.flags[static_cast<unsigned char>(block[i])];
+        std::uint64_t bit = std::uint64_t(1) << i;
+
+        if (flags & DIGIT) masks.digit |= bit;
+        if (flags & OP)    masks.op    |= bit;
+        if (flags & PAREN) masks.paren |= bit;
+        if (flags & (BLANK | SPACE)) masks.space |= bit;
+        if (flags == 0 || (flags & SPACE)) masks.invalid |= bit;
+    }
+}
+
+#ifdef CHAR_CLASS_X86
+
+// SSE4.2: each class is a PCMPESTRM string compare against a character set
+// or a character range, 16 bytes at a time.
+__attribute__((target("sse4.2")))
+void classify_sse42(const char* block, BlockMasks& masks) {
+    const __m128i digits = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i ops    = _mm_setr_epi8('+', '-', '*', '/', '%', 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i parens = _mm_setr_epi8('(', ')', 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i blank  = _mm_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i spaces = _mm_setr_epi8('\t', '\r', 0, 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const int any   = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+    const int range = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK;
+
+    masks = BlockMasks{};
+    for (unsigned i = 0; i < 64; i += 16) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+
+        std::uint64_t digit = _mm_cvtsi128_si32(_mm_cmpestrm(digits, 2, data, 16, range)) & 0xFFFF;
+        std::uint64_t op    = _mm_cvtsi128_si32(_mm_cmpestrm(ops, 5, data, 16, any)) & 0xFFFF;
+        std::uint64_t paren = _mm_cvtsi128_si32(_mm_cmpestrm(parens, 2, data, 16, any)) & 0xFFFF;
+        std::uint64_t ws    = _mm_cvtsi128_si32(_mm_cmpestrm(blank, 1, data, 16, any)) & 0xFFFF;
+        std::uint64_t other = _mm_cvtsi128_si32(_mm_cmpestrm(spaces, 2, data, 16, range)) & 0xFFFF;
+
+        masks.digit |= digit << i;
+        masks.op    |= op << i;
+        masks.paren |= paren << i;
+        masks.space |= (ws | other) << i;
+        masks.invalid |= (~(digit | op | paren | ws) & 0xFFFF) << i;
+    }
+}
+
+// AVX2: byte compares and MOVEMASK, 32 bytes at a time.
+__attribute__((target("avx2")))
+void classify_avx2(const char* block, BlockMasks& masks) {
+    masks = BlockMasks{};
+    for (unsigned i = 0; i < 64; i += 32) {
+        __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+
+        // Unsigned range checks: x - low <= high - low
+        __m256i d = _mm256_sub_epi8(data, _mm256_set1_epi8('0'));
+        __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        __m256i w = _mm256_sub_epi8(data, _mm256_set1_epi8('\t'));
+        __m256i is_other = _mm256_cmpeq_epi8(_mm256_min_epu8(w, _mm256_set1_epi8('\r' - '\t')), w);
+
+        __m256i is_op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('+')),
+                            _mm256_cmpeq_epi8(data, _mm256_set1_epi8('-'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('*')),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('/')),
+                                            _mm256_cmpeq_epi8(data, _mm256_set1_epi8('%')))));
+        __m256i is_paren = _mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('(')),
+                                           _mm256_cmpeq_epi8(data, _mm256_set1_epi8(')')));
+        __m256i is_blank = _mm256_cmpeq_epi8(data, _mm256_set1_epi8(' '));
+
+        std::uint64_t digit = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_digit));
+        std::uint64_t op    = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_op));
+        std::uint64_t paren = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_paren));
+        std::uint64_t ws    = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_blank));
+        std::uint64_t other = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_other));
+
+        masks.digit |= digit << i;
+        masks.op    |= op << i;
+        masks.paren |= paren << i;
+        masks.space |= (ws | other) << i;
+        masks.invalid |= (~(digit | op | paren | ws) & 0xFFFFFFFF) << i;
+    }
+}
+
+#endif // CHAR_CLASS_X86
+
+struct Dispatch {
+    Kernel      kernel;
+    const char* name;
+
+    Dispatch() : kernel(classify_scalar), name("scalar") {
+#ifdef CHAR_CLASS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            kernel = classify_avx2;
+            name = "avx2";
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            kernel = classify_sse42;
+            name = "sse4.2";
+        }
+#endif
+    }
+};
+
+Dispatch& dispatch() {
+    static Dispatch selected;
+    return selected;
+}
+
+} // namespace
+
+bool classify(const char* str, std::size_t length, CharClasses& classes) {
+    trace::Span span(trace::PARSE);
+    Kernel kernel = dispatch().kernel;
+    std::size_t words = (length + 63) / 64;
+    std::size_t full = length / 64;
+    std::uint64_t invalid = 0;
+    BlockMasks masks;
+
+    classes.digit.resize(words);
+    classes.op.resize(words);
+    classes.paren.resize(words);
+    classes.space.resize(words);
+    classes.length = length;
+
+    for (std::size_t i = 0; i < words; ++i) {
+        // The last block is padded with spaces, which are valid
+        if (i == full) {
+            char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, str + i * 64, length - i * 64);
+            kernel(tail, masks);
+        } else {
+            kernel(str + i * 64, masks);
+        }
+
+        classes.digit[i] = masks.digit;
+        classes.op[i]    = masks.op;
+        classes.paren[i] = masks.paren;
+        classes.space[i] = masks.space;
+        invalid |= masks.invalid;
+    }
+
+    classes.valid = (invalid == 0);
+    return classes.valid;
+}
+
+const char* classify_kernel() {
+    return dispatch().name;
+}
+
+bool select_classify_kernel(const char* name) {
+    Dispatch& selected = dispatch();
+    if (std::strcmp(name, "scalar") == 0) {
+        selected.kernel = classify_scalar;
+        selected.name = "scalar";
+        return true;
+    }
+#ifdef CHAR_CLASS_X86
+    __builtin_cpu_init();
+    if (std::strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        selected.kernel = classify_avx2;
+        selected.name = "avx2";
+        return true;
+    }
+    if (std::strcmp(name, "sse4.2") == 0 && __builtin_cpu_supports("sse4.2")) {
+        selected.kernel = classify_sse42;
+        selected.name = "sse4.2";
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,64 @@
+/// @file char_class.hpp
+/// @author Etienne Bravo
+///
+/// @brief Input validation and character classification in a single pass,
+/// with SSE4.2 and AVX2 kernels selected at runtime.
+
+#ifndef CHAR_CLASS_HPP
+#define CHAR_CLASS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// CharClasses holds one bitmap per character class, one bit per input byte.
+/// Byte i of the input is described by bit (i % 64) of word (i / 64). Bits
+/// past the end of the input are set in the space bitmap only.
+
+struct CharClasses {
+    std::vector<std::uint64_t> digit;   ///< '0' to '9'
+    std::vector<std::uint64_t> op;      ///< '+', '-', '*', '/', '%'
+    std::vector<std::uint64_t> paren;   ///< '(' and ')'
+    std::vector<std::uint64_t> space;   ///< any whitespace character
+    std::size_t length = 0;             ///< number of classified bytes
+    bool        valid  = false;         ///< see classify()
+
+    /// Checks a bit of one of the bitmaps.
+    /// @param map One of the bitmaps above.
+    /// @param pos Byte position, must be less than length.
+    /// @return True if the bit of the byte is set.
+    static bool test(const std::vector<std::uint64_t>& map, std::size_t pos) {
+        return (map[pos >> 6] >> (pos & 63)) & 1;
+    }
+};
+
+/// @brief Validates a string and classifies each of its bytes.
+///
+/// Fills the bitmaps of classes and sets classes.valid to true if the string
+/// contains only spaces, digits, operators and parentheses, the characters
+/// accepted by containsOnlyValidChars(). Tabs and other whitespace are
+/// classified as space but make the string invalid.
+///
+/// The bitmaps are reused, so classifying many lines with the same
+/// CharClasses object does not allocate once the longest line has been seen.
+///
+/// @param str Pointer to the first byte.
+/// @param length Number of bytes to classify.
+/// @param classes Receives the bitmaps.
+/// @return The value of classes.valid.
+bool classify(const char* str, std::size_t length, CharClasses& classes);
+
+/// @brief Name of the kernel used by classify() on this machine.
+/// @return "avx2", "sse4.2" or "scalar".
+const char* classify_kernel();
+
+/// @brief Makes classify() use another kernel, to compare the kernels.
+///
+/// Not thread safe, call it while no other thread is classifying.
+///
+/// @param name "avx2", "sse4.2" or "scalar".
+/// @return False if this machine cannot run the kernel, the kernel in use
+/// is then kept.
+bool select_classify_kernel(const char* name);
+
+#endif // CHAR_CLASS_HPP
@@ -0,0 +1,143 @@
+/// @file charclass-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for classify(): the scalar, SSE4.2 and AVX2 kernels
+/// give the same bitmaps and validity, byte for byte, on random buffers of
+/// every length modulo 64, including the padding past the end of the input,
+/// and containsOnlyValidChars() reusing its bitmaps. Build with
+///
+///   make lib && g++ -std=gnu++20 charclass-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "char_class.hpp"  // check include guard
+#include "postfix.hpp"
+
+// Bitmaps built one byte at a time from the definition of each class
+CharClasses expected_classes(const std::string& text) {
+    CharClasses expected;
+    std::size_t words = (text.size() + 63) / 64;
+    expected.digit.assign(words, 0);
+    expected.op.assign(words, 0);
+    expected.paren.assign(words, 0);
+    expected.space.assign(words, 0);
+    expected.length = text.size();
+    expected.valid = true;
+
+    for (std::size_t i = 0; i < words * 64; ++i) {
+        std::uint64_t bit = std::uint64_t(1) << (i % 64);
+        if (i >= text.size()) {
+            expected.space[i / 64] |= bit;  // padding
+            continue;
+        }
+        char c = text[i];
+        if (c >= '0' && c <= '9') {
+            expected.digit[i / 64] |= bit;
+        } else if (c != '\0' && std::strchr("+-*/%", c) != nullptr) {
+            expected.op[i / 64] |= bit;
+        } else if (c == '(' || c == ')') {
+            expected.paren[i / 64] |= bit;
+        } else if (c == ' ') {
+            expected.space[i / 64] |= bit;
+        } else if (c >= '\t' && c <= '\r') {
+            expected.space[i / 64] |= bit;
+            expected.valid = false;
+        } else {
+            expected.valid = false;
+        }
+    }
+    return expected;
+}
+
+// Mostly expression characters, with the neighbours of every class range
+std::string random_text(std::mt19937& random, std::size_t length, bool only_valid) {
+    const char valid[] = "0123456789+-*/%() ";
+    const char invalid[] = {'\t', '\n', '\v', '\f', '\r', '\b', '\x0e', '\x1f', '!', '$', '&', '\'',
+                            ',', '.', ':', '\0', 'a', 'Z', '\x7f', '\x80', '\xb0', '\xff'};
+    std::string text;
+    for (std::size_t i = 0; i < length; ++i) {
+        if (!only_valid && random() % 8 == 0) {
+            text += invalid[random() % sizeof(invalid)];
+        } else {
+            text += valid[random() % (sizeof(valid) - 1)];
+        }
+    }
+    return text;
+}
+
+void check_classes(const CharClasses& found, const CharClasses& expected) {
+    CHECK(found.length == expected.length);
+    CHECK(found.valid == expected.valid);
+    REQUIRE(found.digit.size() == expected.digit.size());
+    for (std::size_t w = 0; w < expected.digit.size(); ++w) {
+        INFO("word " << w);
+        CHECK(found.digit[w] == expected.digit[w]);
+        CHECK(found.op[w] == expected.op[w]);
+        CHECK(found.paren[w] == expected.paren[w]);
+        CHECK(found.space[w] == expected.space[w]);
+    }
+}
+
+// Test every kernel this machine can run against the definition
+TEST_CASE("kernels", "[classify]") {
+    const char* default_kernel = classify_kernel();
+    std::vector<const char*> kernels{"scalar"};
+    for (const char* name : {"sse4.2", "avx2"}) {
+        if (select_classify_kernel(name)) {
+            kernels.push_back(name);
+        } else {
+            WARN(name << " is not supported on this machine");
+        }
+    }
+
+    std::mt19937 random(28);
+    CharClasses classes;  // reused, like the Calculator does
+    for (std::size_t length = 0; length <= 4 * 64 + 1; ++length) {
+        for (int round = 0; round < 4; ++round) {
+            std::string text = random_text(random, length, round == 0);
+            CharClasses expected = expected_classes(text);
+
+            // Bytes after the input must not be read into the bitmaps
+            std::string buffer = text + std::string(64, 'x');
+            for (const char* name : kernels) {
+                INFO("kernel " << name << ", length " << length << ", round " << round);
+                REQUIRE(select_classify_kernel(name));
+                CHECK(classify(buffer.data(), length, classes) == expected.valid);
+                check_classes(classes, expected);
+            }
+        }
+    }
+
+    REQUIRE(select_classify_kernel(default_kernel));
+    CHECK(std::string(classify_kernel()) == default_kernel);
+}
+
+// Test the selection of a kernel
+TEST_CASE("select", "[classify]") {
+    const char* default_kernel = classify_kernel();
+    CHECK_FALSE(select_classify_kernel("neon"));
+    CHECK(std::string(classify_kernel()) == default_kernel);
+    CHECK(select_classify_kernel("scalar"));
+    CHECK(std::string(classify_kernel()) == "scalar");
+    CHECK(select_classify_kernel(default_kernel));
+}
+
+// Test containsOnlyValidChars(), whose bitmaps are kept from one line to the next
+TEST_CASE("valid characters", "[classify]") {
+    std::string longest(300, '1');
+    longest[299] = 'x';
+    CHECK_FALSE(containsOnlyValidChars(longest));
+    CHECK(containsOnlyValidChars("( 12 + 3 ) * 4 % 5 / -6"));
+    CHECK_FALSE(containsOnlyValidChars("1 +\t2"));
+    CHECK(containsOnlyValidChars(""));
+    CHECK(containsOnlyValidChars(std::string(299, '1')));  // shorter than the last, past its 'x'
+    CHECK_FALSE(containsOnlyValidChars("2 + a"));
+}
+
+/* EOF */
@@ -0,0 +1,225 @@
+/// @file cli-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Tests of the postfix_calc command line: runs the executable on
+/// small input files and checks what it prints, the allocation report and
+/// the postfix files of --emit-postfix and --input=rpn. Build with
+///
+///   make && g++ -std=gnu++20 cli-test.cxx -o cli-test
+///
+/// and run it from the directory of postfix_calc.
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+// Temporary directory, removed with its files
+struct TempDir {
+    std::string path;
+
+    TempDir() {
+        char name[] = "/tmp/cli-test-XXXXXX";
+        REQUIRE(::mkdtemp(name) != nullptr);
+        path = name;
+    }
+
+    ~TempDir() { std::filesystem::remove_all(path); }
+
+    // Writes a file of the given lines, each followed by a newline
+    std::string write(const std::string& name, const std::vector<std::string>& lines) const {
+        std::ofstream file(path + "/" + name, std::ios::binary);
+        for (const std::string& line : lines) {
+            file << line << '\n';
+        }
+        return path + "/" + name;
+    }
+};
+
+// Exit status and output of a run
+struct Run {
+    int         status;
+    std::string out;
+    std::string err;
+};
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Runs postfix_calc with the given arguments, the input comes from /dev/null
+Run run(const TempDir& dir, const std::string& args) {
+    REQUIRE(std::filesystem::exists("postfix_calc"));
+    std::string out = dir.path + "/stdout";
+    std::string err = dir.path + "/stderr";
+    int status = std::system(("./postfix_calc " + args + " < /dev/null > " + out + " 2> " + err).c_str());
+    REQUIRE(WIFEXITED(status));
+    return Run{WEXITSTATUS(status), read_file(out), read_file(err)};
+}
+
+// Lines of a text, without their newlines
+std::vector<std::string> lines_of(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Rows of an allocation report, by phase or container, split in fields
+std::map<std::string, std::vector<std::string>> report_rows(const std::string& report) {
+    std::map<std::string, std::vector<std::string>> rows;
+    for (const std::string& line : lines_of(report)) {
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+        for (std::string field; fields >> field;) {
+            rows[name].push_back(field);
+        }
+    }
+    return rows;
+}
+
+// Lines that stay within the storage a Calculator reserves
+const std::vector<std::string> shallow{"2 + 3 * 4", "( 1 + 2 ) * 3", "-7 / 2", "10 % 4 - 1"};
+
+// One line nested deeper than that storage
+std::string deep_line() {
+    std::string open;
+    std::string close;
+    for (int i = 0; i < 100; ++i) {
+        open += "( ";
+        close += " )";
+    }
+    return open + "1" + close;
+}
+
+// Test --alloc-report
+TEST_CASE("allocation report", "[cli]") {
+    TempDir dir;
+
+    SECTION("the storage reserved up front has a row of its own") {
+        Run result = run(dir, "--alloc-report " + dir.write("shallow.txt", shallow));
+        REQUIRE(result.status == 0);
+        CHECK(result.err.find("Allocation report (4 expressions)") != std::string::npos);
+
+        auto rows = report_rows(result.err);
+        REQUIRE(rows.count("reserve") == 1);
+        CHECK(std::stoul(rows["reserve"][0]) > 0);
+        CHECK(rows["reserve"].size() == 5);  // no averages
+
+        // A warm Calculator does not allocate, and the averages say so
+        for (const char* name : {"convert", "evaluate", "LList<char>", "LList<int>"}) {
+            INFO(name);
+            REQUIRE(rows[name].size() == 7);
+            CHECK(rows[name][5] == "0.00");
+            CHECK(rows[name][6] == "0.00");
+        }
+        CHECK(rows["evaluate"][0] == "0");
+        CHECK(std::stoul(rows["LList<char>"][0]) > 0);  // the reserve, not averaged
+    }
+
+    SECTION("conversion and evaluation are counted apart") {
+        std::vector<std::string> lines = shallow;
+        lines.push_back(deep_line());
+        std::string input = dir.write("deep.txt", lines);
+
+        // The single pass evaluator converts nothing
+        auto rows = report_rows(run(dir, "--alloc-report " + input).err);
+        REQUIRE(rows["evaluate"].size() == 7);
+        std::size_t evaluated = std::stoul(rows["evaluate"][0]);
+        CHECK(evaluated > 0);
+        CHECK(std::stod(rows["evaluate"][5]) == Approx(evaluated / 5.0).epsilon(0.01));
+        CHECK(rows["convert"][0] == "0");
+
+        // --emit-postfix converts with its own stack, then evaluates
+        rows = report_rows(run(dir, "--alloc-report --emit-postfix " + dir.path + "/out.rpn " + input).err);
+        CHECK(std::stoul(rows["convert"][0]) > 0);
+        CHECK(std::stoul(rows["reserve"][0]) > 0);
+    }
+}
+
+// Test --emit-postfix and --input=rpn
+TEST_CASE("postfix files", "[cli]") {
+    TempDir dir;
+    std::string rpn = dir.path + "/out.rpn";
+    std::vector<std::string> infix = shallow;
+    infix.insert(infix.begin() + 2, "1 + 2 + 3 + 4 + 5 + 6");  // 11 tokens
+    infix.push_back("1 2");
+    std::string input = dir.write("infix.txt", infix);
+
+    SECTION("the emitted file reads back to the same cases") {
+        Run emitted = run(dir, "--emit-postfix " + rpn + " " + input);
+        REQUIRE(emitted.status == 0);
+        CHECK(lines_of(read_file(rpn)) == std::vector<std::string>{"2 3 4 * +", "1 2 + 3 *", "1 2 + 3 + 4 + 5 + 6 +",
+                                                                   "-7 2 /", "10 4 % 1 -", "1 2"});
+        CHECK(lines_of(emitted.out) == std::vector<std::string>{"Case 1: 14", "Case 2: 9", "Case 3: 21", "Case 4: -3",
+                                                                "Case 5: 1", "Case 6: malformed expression"});
+
+        Run plain = run(dir, input);
+        Run read_back = run(dir, "--input=rpn " + rpn);
+        CHECK(read_back.status == 0);
+        CHECK(read_back.out == emitted.out);
+        CHECK(plain.out == emitted.out);
+    }
+
+    SECTION("a line over a limit is left blank, and the cases stay aligned") {
+        Run emitted = run(dir, "--max-tokens=9 --emit-postfix " + rpn + " " + input);
+        REQUIRE(emitted.status == 0);
+        std::vector<std::string> lines = lines_of(read_file(rpn));
+        REQUIRE(lines.size() == infix.size());
+        CHECK(lines[2] == "");
+        CHECK(lines[3] == "-7 2 /");
+        CHECK(lines_of(emitted.out)[2] == "Case 3: token limit exceeded");
+
+        std::vector<std::string> cases = lines_of(run(dir, "--input=rpn " + rpn).out);
+        REQUIRE(cases.size() == infix.size());
+        CHECK(cases[2] == "Case 3: malformed expression");
+        CHECK(cases[3] == "Case 4: -3");
+    }
+
+    SECTION("malformed postfix lines, alone and in a batch") {
+        std::vector<std::string> bad{"2 3 +", "1 +", "+", "4 5 * 6", "", "7 2 -"};
+        std::vector<std::string> expected{"Case 1: 5", "Case 2: malformed expression", "Case 3: malformed expression",
+                                          "Case 4: malformed expression", "Case 5: malformed expression", "Case 6: 5"};
+        std::string first = dir.write("bad.rpn", bad);
+        std::string second = dir.write("bad2.rpn", bad);
+
+        Run alone = run(dir, "--input=rpn " + first);
+        CHECK(alone.status == 0);
+        CHECK(lines_of(alone.out) == expected);
+
+        REQUIRE(run(dir, "--input=rpn " + first + " " + second).status == 0);
+        CHECK(lines_of(read_file(first + ".out")) == expected);
+        CHECK(lines_of(read_file(second + ".out")) == expected);
+    }
+
+    SECTION("options that do not mix") {
+        CHECK(run(dir, "--input=rpn --stream " + rpn).status != 0);
+        CHECK(run(dir, "--input=rpn --emit-postfix " + rpn + " " + input).status != 0);
+        CHECK(run(dir, "--emit-postfix " + rpn + " " + input + " " + input).status != 0);
+    }
+}
+
+// Test --max-length
+TEST_CASE("line length limit", "[cli]") {
+    TempDir dir;
+    Run result = run(dir, "--max-length=9 " + dir.write("lines.txt", shallow));
+    REQUIRE(result.status == 0);
+    CHECK(lines_of(result.out) == std::vector<std::string>{"Case 1: 14", "Case 2: length limit exceeded", "Case 3: -3",
+                                                           "Case 4: length limit exceeded"});
+}
+
+/* EOF */
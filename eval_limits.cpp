@@ -0,0 +1,60 @@
+/// @file eval_limits.cpp
+/// @author Etienne Bravo
+///
+/// @brief Status names and the slow paths of the Budget class.
+
+#include "eval_limits.hpp"
+
+const char* status_name(EvalStatus status)
+{
+    switch (status)
+    {
+        case EvalStatus::OK:                return "ok";
+        case EvalStatus::INVALID_CHARACTER: return "invalid character";
+        case EvalStatus::MALFORMED:         return "malformed expression";
+        case EvalStatus::DIVISION_BY_ZERO:  return "division by zero";
+        case EvalStatus::OUT_OF_RANGE:      return "out of range";
+        case EvalStatus::LENGTH_LIMIT:      return "length limit exceeded";
+        case EvalStatus::TOKEN_LIMIT:       return "token limit exceeded";
+        case EvalStatus::DEPTH_LIMIT:       return "nesting limit exceeded";
+        case EvalStatus::STACK_LIMIT:       return "stack limit exceeded";
+        case EvalStatus::TIME_LIMIT:        return "time limit exceeded";
+        case EvalStatus::CANCELLED:         return "cancelled";
+    }
+    return "unknown status";
+}
+
+Budget::Budget(const EvalLimits& limits, std::size_t length)
+: limits(limits), timed(limits.max_time != std::chrono::nanoseconds::max())
+{
+    if (length > limits.max_length)
+    {
+        fail(EvalStatus::LENGTH_LIMIT);
+    }
+    // The clock is only read when there is a time limit
+    if (timed)
+    {
+        deadline = std::chrono::steady_clock::now() + limits.max_time;
+    }
+    if (limits.cancel != nullptr && limits.cancel->cancelled())
+    {
+        fail(EvalStatus::CANCELLED);
+    }
+}
+
+void Budget::check() const
+{
+    if (limits.cancel != nullptr && limits.cancel->cancelled())
+    {
+        fail(EvalStatus::CANCELLED);
+    }
+    if (timed && std::chrono::steady_clock::now() > deadline)
+    {
+        fail(EvalStatus::TIME_LIMIT);
+    }
+}
+
+void Budget::fail(EvalStatus status)
+{
+    throw LimitExceeded(status);
+}
@@ -0,0 +1,150 @@
+/// @file eval_limits.hpp
+/// @author Etienne Bravo
+///
+/// @brief Statuses of an evaluation, and the limits that bound the cost of
+/// one expression.
+
+#ifndef EVAL_LIMITS_HPP
+#define EVAL_LIMITS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+/// Outcome of the evaluation of one expression.
+enum class EvalStatus : std::uint8_t {
+    OK,                 ///< the result is the value of the expression
+    INVALID_CHARACTER,  ///< a character other than digits, operators, parentheses and spaces
+    MALFORMED,          ///< missing operand or operator, unbalanced parentheses, bad literal
+    DIVISION_BY_ZERO,   ///< '/' or '%' by zero
+    OUT_OF_RANGE,       ///< literal out of range, or smallest value divided by -1
+    LENGTH_LIMIT,       ///< more bytes than EvalLimits::max_length
+    TOKEN_LIMIT,        ///< more tokens than EvalLimits::max_tokens
+    DEPTH_LIMIT,        ///< parentheses nested deeper than EvalLimits::max_depth
+    STACK_LIMIT,        ///< a stack larger than EvalLimits::max_stack
+    TIME_LIMIT,         ///< longer than EvalLimits::max_time
+    CANCELLED,          ///< the CancelToken of the limits was cancelled
+};
+
+/// @return The name of a status, e.g. "division by zero".
+const char* status_name(EvalStatus status);
+
+/// @brief Flag that stops the evaluations using it, from any thread.
+///
+/// The evaluators read it with a relaxed load every few hundred tokens, so
+/// it costs nothing measurable. It stays set until reset().
+class CancelToken {
+public:
+    /// Makes the evaluations using this token fail with EvalStatus::CANCELLED.
+    void cancel() noexcept { flag.store(true, std::memory_order_relaxed); }
+
+    /// @return True once cancel() was called.
+    bool cancelled() const noexcept { return flag.load(std::memory_order_relaxed); }
+
+    /// Lets new evaluations run again.
+    void reset() noexcept { flag.store(false, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> flag{false};
+};
+
+/// @brief Cost limits of one expression, all unlimited by default.
+///
+/// Example Usage:
+/// @code
+///   CancelToken cancel;
+///   EvalLimits limits;
+///   limits.max_length = 1 << 20;
+///   limits.max_tokens = 100000;
+///   limits.max_depth  = 256;
+///   limits.max_time   = std::chrono::milliseconds(5);
+///   limits.cancel     = &cancel;  // cancel.cancel() from another thread
+///   Calculator<int>::local().set_limits(limits);
+/// @endcode
+struct EvalLimits {
+    static const std::size_t unlimited = SIZE_MAX;
+
+    std::size_t              max_length = unlimited;  ///< bytes of the expression
+    std::size_t              max_tokens = unlimited;  ///< numbers, operators and parentheses
+    std::size_t              max_depth  = unlimited;  ///< open parentheses at once
+    std::size_t              max_stack  = unlimited;  ///< elements of the operator or value stack
+    std::chrono::nanoseconds max_time   = std::chrono::nanoseconds::max();  ///< wall time
+    const CancelToken*       cancel     = nullptr;    ///< checked with the time, if any
+};
+
+/// @brief Thrown by the evaluators when an expression exceeds its limits.
+class LimitExceeded : public std::runtime_error {
+public:
+    /// @param status One of the limit statuses, LENGTH_LIMIT to CANCELLED.
+    explicit LimitExceeded(EvalStatus status)
+    : std::runtime_error(status_name(status)), reason(status) {}
+
+    /// @return The limit that was exceeded.
+    EvalStatus status() const noexcept { return reason; }
+
+private:
+    EvalStatus reason;
+};
+
+/// @brief Spending of one expression against its EvalLimits.
+///
+/// Evaluators start a budget before they classify the expression, so one
+/// that is too long or already cancelled is rejected without a pass over
+/// it, then call token() for every token and depth() and stack() as the
+/// parentheses and stacks grow. The counts are compared on every call, the
+/// clock and the CancelToken are only read every check_period tokens.
+class Budget {
+public:
+    /// Checks the length and the CancelToken, and starts the clock.
+    /// @param limits The limits, must outlive the budget.
+    /// @param length Bytes of the expression.
+    /// @throws LimitExceeded if the expression is too long or the evaluation
+    /// is already cancelled.
+    Budget(const EvalLimits& limits, std::size_t length);
+
+    /// Counts a token.
+    /// @throws LimitExceeded if a limit is exceeded.
+    void token() {
+        if (++tokens > limits.max_tokens) {
+            fail(EvalStatus::TOKEN_LIMIT);
+        }
+        if (tokens % check_period == 0) {
+            check();
+        }
+    }
+
+    /// @param open Number of open parentheses.
+    /// @throws LimitExceeded if open is over the limit.
+    void depth(std::size_t open) const {
+        if (open > limits.max_depth) {
+            fail(EvalStatus::DEPTH_LIMIT);
+        }
+    }
+
+    /// @param size Number of elements of a stack.
+    /// @throws LimitExceeded if size is over the limit.
+    void stack(std::size_t size) const {
+        if (size > limits.max_stack) {
+            fail(EvalStatus::STACK_LIMIT);
+        }
+    }
+
+    /// Checks the wall time and the CancelToken.
+    /// @throws LimitExceeded if either stops the evaluation.
+    void check() const;
+
+    /// Tokens between two reads of the clock and of the CancelToken.
+    static const std::size_t check_period = 256;
+
+private:
+    [[noreturn]] static void fail(EvalStatus status);
+
+    const EvalLimits&                     limits;
+    std::size_t                           tokens = 0;
+    bool                                  timed;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+#endif // EVAL_LIMITS_HPP
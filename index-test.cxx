@@ -0,0 +1,209 @@
+/// @file index-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the LineIndex and Checkpoint classes of libpostfix:
+/// ranges of cases read through the index give the cases of a plain run,
+/// stale and damaged sidecar files are not used, and a run resumes from a
+/// checkpoint but not from a cut one. Build with
+///
+///   make lib && g++ -std=gnu++20 index-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "line_index.hpp"  // check include guard
+#include "postfix.hpp"
+
+// Input file of count lines in a temporary directory, removed with its sidecars
+struct InputFile {
+    std::string dir;
+    std::string path;
+    std::vector<std::string> lines;
+
+    explicit InputFile(std::size_t count, bool final_newline = true) {
+        char name[] = "/tmp/index-test-XXXXXX";
+        REQUIRE(::mkdtemp(name) != nullptr);
+        dir = name;
+        path = dir + "/input.txt";
+
+        std::ofstream file(path, std::ios::binary);
+        for (std::size_t i = 0; i < count; ++i) {
+            lines.push_back(std::to_string(i % 97) + " * ( " + std::string(i % 7, '1') + "0 + " +
+                            std::to_string(i) + " )");
+            file << lines.back() << (i + 1 < count || final_newline ? "\n" : "");
+        }
+    }
+
+    ~InputFile() { std::filesystem::remove_all(dir); }
+
+    // Results of a plain run, one line after the other
+    std::vector<int> plain() const {
+        std::vector<int> results;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            results.push_back(eval_infix<int>(line));
+        }
+        return results;
+    }
+};
+
+// Results of the cases first to last, like --cases=first-last
+std::vector<int> cases(const std::string& path, std::uint64_t first, std::uint64_t last) {
+    std::ifstream file(path);
+    std::vector<int> results;
+    std::string line;
+    for (LinePosition at = LineIndex(path).seek(file, first); at.line <= last && std::getline(file, line); at.line++) {
+        results.push_back(eval_infix<int>(line));
+    }
+    return results;
+}
+
+// Test ranges of cases against a plain run
+TEST_CASE("ranges", "[index]") {
+    const std::uint64_t stride = LineIndex::stride;
+
+    for (bool final_newline : {true, false}) {
+        InputFile input(3 * stride + 100, final_newline);
+        std::vector<int> all = input.plain();
+        std::uint64_t count = all.size();
+        REQUIRE(count == input.lines.size());
+
+        LineIndex index(input.path);
+        CHECK(index.lines() == count);
+        CHECK(std::filesystem::exists(input.path + ".idx"));
+
+        // seek() stops at the line, or after the last one
+        std::ifstream file(input.path);
+        std::string line;
+        LinePosition at = index.seek(file, stride + 2);
+        CHECK(at.line == stride + 2);
+        REQUIRE(std::getline(file, line));
+        CHECK(line == input.lines[stride + 1]);
+        CHECK(index.seek(file, count + 5).line == count + 1);
+
+        struct Range {
+            std::uint64_t first, last;
+        };
+        for (Range range : {Range{1, 1}, Range{1, count}, Range{2, 9}, Range{stride - 1, stride + 1},
+                            Range{stride, 2 * stride + 1}, Range{2 * stride + 1, 2 * stride + 1},
+                            Range{count, count}, Range{3000, UINT64_MAX}, Range{count + 1, UINT64_MAX}}) {
+            INFO("cases " << range.first << "-" << range.last << (final_newline ? "" : ", no final newline"));
+            std::uint64_t last = std::min(range.last, count);
+            std::vector<int> expected;
+            if (range.first <= last) {
+                expected.assign(all.begin() + (range.first - 1), all.begin() + last);
+            }
+            CHECK(cases(input.path, range.first, range.last) == expected);
+        }
+    }
+}
+
+// Test that sidecar files made for another file, or damaged, are not used
+TEST_CASE("stale and damaged indexes", "[index]") {
+    InputFile input(2 * LineIndex::stride + 5);
+    std::vector<int> all = input.plain();
+    LineIndex(input.path);  // saves input.txt.idx
+
+    SECTION("a saved index gives the same positions") {
+        LineIndex loaded(input.path);
+        CHECK(loaded.lines() == input.lines.size());
+        CHECK(cases(input.path, LineIndex::stride + 3, LineIndex::stride + 6) ==
+              std::vector<int>(all.begin() + LineIndex::stride + 2, all.begin() + LineIndex::stride + 6));
+    }
+
+    SECTION("the input grew") {
+        std::ofstream(input.path, std::ios::app) << "1 + 1\n2 + 2\n";
+        CHECK(LineIndex(input.path).lines() == input.lines.size() + 2);
+        CHECK(cases(input.path, input.lines.size() + 2, UINT64_MAX) == std::vector<int>{4});
+    }
+
+    SECTION("a cut index file") {
+        std::filesystem::resize_file(input.path + ".idx", 60);
+        CHECK(LineIndex(input.path).lines() == input.lines.size());
+        CHECK(cases(input.path, 2 * LineIndex::stride + 1, UINT64_MAX) ==
+              std::vector<int>(all.end() - 5, all.end()));
+    }
+}
+
+// Test resuming from a checkpoint
+TEST_CASE("checkpoints", "[index]") {
+    InputFile input(5000);
+    std::vector<int> all = input.plain();
+
+    // The position after case 1999, as a run saves it
+    std::uint64_t offset = 0;
+    for (std::size_t i = 0; i < 1999; ++i) {
+        offset += input.lines[i].size() + 1;
+    }
+    LinePosition written{2000, offset};
+    Checkpoint(input.path).save(written);
+
+    // Resumes at the saved line, or at line 1 without a usable checkpoint
+    auto resume = [&] {
+        LinePosition next{1, 0};
+        Checkpoint(input.path).load(next);
+        std::ifstream file(input.path);
+        file.seekg(static_cast<std::streamoff>(next.offset));
+        std::vector<int> results;
+        std::string line;
+        while (std::getline(file, line)) {
+            results.push_back(eval_infix<int>(line));
+        }
+        return std::pair<LinePosition, std::vector<int>>(next, results);
+    };
+
+    SECTION("a whole checkpoint") {
+        auto resumed = resume();
+        CHECK(resumed.first.line == 2000);
+        CHECK(resumed.first.offset == offset);
+        CHECK(resumed.second == std::vector<int>(all.begin() + 1999, all.end()));
+    }
+
+    SECTION("a checkpoint cut anywhere is not used") {
+        std::string ckpt = input.path + ".ckpt";
+        std::uintmax_t size = std::filesystem::file_size(ckpt);
+        for (std::uintmax_t cut = 0; cut < size; ++cut) {
+            INFO("cut to " << cut << " of " << size << " bytes");
+            Checkpoint(input.path).save(written);
+            std::filesystem::resize_file(ckpt, cut);
+            auto resumed = resume();
+            CHECK(resumed.first.line == 1);
+            CHECK(resumed.second == all);
+        }
+    }
+
+    SECTION("a checkpoint of another version of the file is not used") {
+        std::ofstream(input.path, std::ios::app) << "1 + 1\n";
+        CHECK(resume().first.line == 1);
+    }
+
+    SECTION("a checkpoint that cannot be replaced reports why") {
+        std::string ckpt = input.path + ".ckpt";
+        std::filesystem::remove(ckpt);
+        std::filesystem::create_directory(ckpt);
+        try {
+            Checkpoint(input.path).save(written);
+            FAIL("saved over a directory");
+        } catch (const std::system_error& e) {
+            CHECK(e.code() == std::errc::is_a_directory);
+        }
+        CHECK_FALSE(std::filesystem::exists(ckpt + ".tmp"));
+    }
+
+    SECTION("a finished run leaves no checkpoint") {
+        Checkpoint(input.path).remove();
+        CHECK_FALSE(std::filesystem::exists(input.path + ".ckpt"));
+        CHECK(resume().first.line == 1);
+    }
+}
+
+/* EOF */
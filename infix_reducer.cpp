@@ -0,0 +1,115 @@
+/// @file infix_reducer.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the InfixReducer class.
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include "eval_limits.hpp"
+#include "infix_reducer.hpp"
+#include "numeric.hpp"
+#include "postfix.hpp"
+
+template <class Num>
+void InfixReducer<Num>::push_operator(char op)
+{
+    // Open parenthesis
+    if (op == '(')
+    {
+        operators.push(op);
+    }
+
+    // If close parenthesis
+    else if (op == ')')
+    {
+        while (!operators.empty() && operators.top() != '(')
+        {
+            apply(operators.top());
+            operators.pop();
+        }
+        operators.pop();
+    }
+
+    // If operator is found
+    else
+    {
+        while (!operators.empty() && precedence(op) <= precedence(operators.top()))
+        {
+            apply(operators.top());
+            operators.pop();
+        }
+        operators.push(op);
+    }
+}
+
+template <class Num>
+Num InfixReducer<Num>::finish()
+{
+    // clear the stack when input ends
+    while (!operators.empty())
+    {
+        apply(operators.top());
+        operators.pop();
+    }
+
+    Num result = values.top();
+    values.pop();
+    reset();
+    return result;
+}
+
+template <class Num>
+void InfixReducer<Num>::reset()
+{
+    while (!operators.empty())
+    {
+        operators.pop();
+    }
+    while (!values.empty())
+    {
+        values.pop();
+    }
+}
+
+template <class Num>
+void InfixReducer<Num>::apply(char op)
+{
+    Num operand1 = values.top();
+    values.pop();
+    Num operand2 = values.top();
+    values.pop();
+
+    switch (op) {
+        case '+':
+            values.push(Numeric<Num>::add(operand2, operand1));
+            break;
+        case '-':
+            values.push(Numeric<Num>::subtract(operand2, operand1));
+            break;
+        case '*':
+            values.push(Numeric<Num>::multiply(operand2, operand1));
+            break;
+        case '/':
+            values.push(Numeric<Num>::divide(operand2, operand1));
+            break;
+        case '%':
+            values.push(Numeric<Num>::remainder(operand2, operand1));
+            break;
+        default:
+            std::cerr << "Unknown operator: " << op << std::endl;
+            break;
+    }
+}
+
+void InfixGrammar::fail()
+{
+    throw std::invalid_argument(status_name(EvalStatus::MALFORMED));
+}
+
+// Reducers for the supported numeric types
+template class InfixReducer<int>;
+template class InfixReducer<std::int64_t>;
+template class InfixReducer<__int128>;
+template class InfixReducer<double>;
+template class InfixReducer<Decimal>;
@@ -0,0 +1,154 @@
+/// @file infix_reducer.hpp
+/// @author Etienne Bravo
+///
+/// @brief Operator and value stacks of the single pass Infix evaluators.
+
+#ifndef INFIX_REDUCER_HPP
+#define INFIX_REDUCER_HPP
+
+#include <cstddef>
+#include "Stack.hpp"
+
+/// @brief Shunting-yard algorithm that evaluates instead of emitting Postfix.
+///
+/// infix2postfix() moves operators from its stack to the Postfix string and
+/// eval_postfix() later applies them to a value stack. InfixReducer does
+/// both at once: whenever infix2postfix() would emit an operator, the
+/// operator is applied to the top two values right away. The tokens of the
+/// expression are given to it in Infix order by eval_infix() and by the
+/// StreamEvaluator class.
+///
+/// @tparam Num Numeric type used for operands and results.
+///
+/// Example Usage:
+/// @code
+///   InfixReducer<int> reducer;     // 2 + 3 * 4
+///   reducer.push_value(2);
+///   reducer.push_operator('+');
+///   reducer.push_value(3);
+///   reducer.push_operator('*');
+///   reducer.push_value(4);
+///   std::cout << reducer.finish() << std::endl; // Outputs: 14
+/// @endcode
+
+template <class Num = int>
+class InfixReducer {
+public:
+    /// Pushes an operand.
+    /// @param value The operand.
+    void push_value(const Num& value) { values.push(value); }
+
+    /// Applies the pending operators of higher or equal precedence, then
+    /// pushes op. Parentheses are handled too.
+    /// @param op Operator, '(' or ')'.
+    void push_operator(char op);
+
+    /// Applies the remaining operators and empties the stacks.
+    /// @return Num The value of the expression.
+    Num finish();
+
+    /// Discards a partially reduced expression.
+    void reset();
+
+    /// Keeps storage for depth operators and values, so expressions nested
+    /// up to depth are reduced without allocating.
+    /// @param depth Number of elements to keep storage for, on each stack.
+    void reserve(std::size_t depth) {
+        operators.reserve(depth);
+        values.reserve(depth);
+    }
+
+    /// @return Number of pending operators and open parentheses.
+    std::size_t operator_depth() const { return operators.size(); }
+
+    /// @return Number of values on the value stack.
+    std::size_t value_depth() const { return values.size(); }
+
+    /// Pops two values, applies op to them and pushes the result. With
+    /// push_value(), this is a step of a Postfix evaluation.
+    /// @param op Operator.
+    void apply(char op);
+
+private:
+    Stack<char> operators;  ///< pending operators and parentheses
+    Stack<Num>  values;     ///< operands and partial results
+};
+
+/// @brief Checks that the tokens given to an InfixReducer form an Infix
+/// expression.
+///
+/// InfixReducer applies whatever it is given: it drops a value given after
+/// another one, and a ')' without its '(' pops nothing. The single pass
+/// evaluators give every token to an InfixGrammar first, which throws at
+/// the first token out of place, and call finish() at the end of the
+/// expression. Operands and binary operators must alternate, starting and
+/// ending with an operand, and parentheses must be balanced.
+///
+/// Example Usage:
+/// @code
+///   InfixGrammar grammar;   // 2 3
+///   grammar.value();
+///   grammar.value();        // throws std::invalid_argument
+/// @endcode
+
+class InfixGrammar {
+public:
+    /// An operand.
+    /// @throws std::invalid_argument if an operator or ')' was expected.
+    void value() {
+        if (!operand) {
+            fail();
+        }
+        operand = false;
+    }
+
+    /// An operator, '(' or ')'.
+    /// @throws std::invalid_argument if the symbol is out of place.
+    void symbol(char op) {
+        if (op == '(') {
+            if (!operand) {
+                fail();
+            }
+            ++depth;
+        } else if (op == ')') {
+            if (operand || depth == 0) {
+                fail();
+            }
+            --depth;
+        } else {
+            if (operand) {
+                fail();
+            }
+            operand = true;
+        }
+    }
+
+    /// Checks the end of the expression and starts a new one.
+    /// @throws std::invalid_argument if an operand is missing or a
+    /// parenthesis is still open.
+    void finish() {
+        bool complete = !operand && depth == 0;
+        reset();
+        if (!complete) {
+            fail();
+        }
+    }
+
+    /// Starts a new expression.
+    void reset() {
+        operand = true;
+        depth = 0;
+    }
+
+    /// @return Number of open parentheses.
+    std::size_t open() const { return depth; }
+
+private:
+    /// @throws std::invalid_argument with the message of EvalStatus::MALFORMED.
+    [[noreturn]] static void fail();
+
+    bool        operand = true;  ///< an operand or '(' comes next
+    std::size_t depth = 0;       ///< open parentheses
+};
+
+#endif // INFIX_REDUCER_HPP
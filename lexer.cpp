@@ -0,0 +1,56 @@
+/// @file lexer.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the Lexer class.
+
+#include "lexer.hpp"
+
+Token Lexer::next()
+{
+    std::size_t length = classes.length;
+
+    pos = skip(classes.space, pos);
+    if (pos >= length)
+    {
+        return Token{Token::END, str + length, str + length};
+    }
+
+    std::size_t start = pos;
+
+    // Numbers and negative numbers
+    bool sign = str[pos] == '-' && pos + 1 < length &&
+                CharClasses::test(classes.digit, pos + 1);
+    if (sign || CharClasses::test(classes.digit, pos))
+    {
+        pos = skip(classes.digit, sign ? pos + 1 : pos);
+        return Token{Token::NUMBER, str + start, str + pos};
+    }
+
+    ++pos;
+    return Token{Token::SYMBOL, str + start, str + pos};
+}
+
+std::size_t Lexer::skip(const std::vector<std::uint64_t>& map, std::size_t from) const
+{
+    std::size_t length = classes.length;
+    std::size_t word = from >> 6;
+
+    if (from >= length)
+    {
+        return length;
+    }
+
+    // Clear bits of the first word, ignoring the bytes before from
+    std::uint64_t clear = ~map[word] & (~std::uint64_t(0) << (from & 63));
+    while (clear == 0)
+    {
+        if (++word == map.size())
+        {
+            return length;
+        }
+        clear = ~map[word];
+    }
+
+    std::size_t found = (word << 6) + __builtin_ctzll(clear);
+    return found < length ? found : length;
+}
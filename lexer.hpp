@@ -0,0 +1,71 @@
+/// @file lexer.hpp
+/// @author Etienne Bravo
+///
+/// @brief Tokenizer for Infix and Postfix expressions driven by the bitmaps
+/// of classify().
+
+#ifndef LEXER_HPP
+#define LEXER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "char_class.hpp"
+
+/// Token is a piece of an expression. The text of the token is not copied,
+/// first and last point into the tokenized string.
+
+struct Token {
+    enum Kind {
+        END,     ///< no more tokens
+        NUMBER,  ///< number, with its '-' sign if it has one
+        SYMBOL,  ///< operator, parenthesis or any other single character
+    };
+
+    Kind        kind;
+    const char* first;  ///< first character of the token
+    const char* last;   ///< one past the last character of the token
+
+    /// @return The character of a SYMBOL token.
+    char symbol() const { return *first; }
+};
+
+/// Lexer splits an expression into tokens. Instead of testing every byte, it
+/// uses the space and digit bitmaps of a CharClasses object to jump over runs
+/// of whitespace and digits a 64 bit word at a time.
+///
+/// A '-' directly followed by a digit is the sign of a number, any other
+/// character that is not whitespace or a digit is a single SYMBOL.
+///
+/// Example Usage:
+/// @code
+///   CharClasses classes;
+///   classify(str.data(), str.size(), classes);
+///   Lexer lexer(str.data(), classes);
+///   for (Token t = lexer.next(); t.kind != Token::END; t = lexer.next()) { ... }
+/// @endcode
+
+class Lexer {
+public:
+    /// Constructs a lexer over a classified string.
+    /// @param str The string given to classify().
+    /// @param classes The bitmaps filled by classify(), must outlive the lexer.
+    Lexer(const char* str, const CharClasses& classes)
+    : str(str), classes(classes), pos(0) {}
+
+    /// Reads the next token.
+    /// @return The token, of kind END once the string is exhausted.
+    Token next();
+
+private:
+    /// Finds the first byte at or after from whose bit in map is clear.
+    /// @return The position of the byte, or the length of the string.
+    std::size_t skip(const std::vector<std::uint64_t>& map, std::size_t from) const;
+
+    const char*        str;
+    const CharClasses& classes;
+    std::size_t        pos;      ///< position of the next unread byte
+};
+
+#endif // LEXER_HPP
@@ -0,0 +1,277 @@
+/// @file line_index.cpp
+/// @author Etienne Bravo
+///
+/// @brief Building, saving and loading of line offset indexes and
+/// checkpoints.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "line_index.hpp"
+
+namespace {
+
+/// Bytes read at a time while building an index.
+const std::size_t read_block = 1 << 20;
+
+/// First bytes of an index file.
+const char index_magic[8] = {'P', 'F', 'X', 'I', 'D', 'X', '0', '1'};
+
+/// Fixed part of an index file, followed by the offsets.
+struct IndexHeader {
+    char          magic[8];
+    std::uint64_t stride;
+    std::uint64_t size;
+    std::int64_t  sec;
+    std::int64_t  nsec;
+    std::uint64_t lines;
+    std::uint64_t count;  ///< number of offsets
+};
+
+/// @return Number of indexed lines of a file of lines lines, line 1 is
+/// indexed even in an empty file.
+std::uint64_t indexed_lines(std::uint64_t lines)
+{
+    return lines == 0 ? 1 : (lines - 1) / LineIndex::stride + 1;
+}
+
+/// @return errno, or EIO if the failed call did not set it.
+int last_error()
+{
+    return errno != 0 ? errno : EIO;
+}
+
+/// Writes a file under a temporary name and renames it over path, so
+/// readers never see it half written.
+/// @return 0, or the errno of the step that failed, taken before the
+/// temporary file is removed.
+template <class Writer>
+int replace_file(const std::string& path, Writer writer)
+{
+    std::string temporary = path + ".tmp";
+    {
+        errno = 0;
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            return last_error();
+        }
+        writer(file);
+        file.flush();
+        if (!file)
+        {
+            int error = last_error();
+            file.close();
+            std::remove(temporary.c_str());
+            return error;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        int error = errno;
+        std::remove(temporary.c_str());
+        return error;
+    }
+    return 0;
+}
+
+} // namespace
+
+FileStamp FileStamp::of(const std::string& path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "stat " + path);
+    }
+
+    FileStamp stamp;
+    stamp.size = static_cast<std::uint64_t>(info.st_size);
+    stamp.sec  = info.st_mtim.tv_sec;
+    stamp.nsec = info.st_mtim.tv_nsec;
+    return stamp;
+}
+
+LineIndex::LineIndex(const std::string& path) : stamp(FileStamp::of(path))
+{
+    std::string index_path = path + ".idx";
+    if (!load(index_path))
+    {
+        build(path);
+        save(index_path);
+    }
+}
+
+LinePosition LineIndex::find(std::uint64_t line) const
+{
+    std::uint64_t i = line > 0 ? (line - 1) / stride : 0;
+    if (i >= offsets.size())
+    {
+        i = offsets.size() - 1;
+    }
+    return LinePosition{i * stride + 1, offsets[i]};
+}
+
+LinePosition LineIndex::seek(std::istream& file, std::uint64_t line) const
+{
+    LinePosition start = find(line);
+    file.seekg(static_cast<std::streamoff>(start.offset));
+
+    // At most stride - 1 lines are read
+    std::string skipped;
+    while (start.line < line && std::getline(file, skipped))
+    {
+        start.offset += skipped.size() + 1;
+        start.line++;
+    }
+
+    return start;
+}
+
+bool LineIndex::load(const std::string& index_path)
+{
+    std::ifstream file(index_path, std::ios::binary);
+    IndexHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof header) ||
+        std::memcmp(header.magic, index_magic, sizeof index_magic) != 0 ||
+        header.stride != stride || header.size != stamp.size ||
+        header.sec != stamp.sec || header.nsec != stamp.nsec ||
+        header.count != indexed_lines(header.lines))
+    {
+        return false;
+    }
+
+    offsets.resize(header.count);
+    if (!file.read(reinterpret_cast<char*>(offsets.data()), header.count * sizeof(std::uint64_t)))
+    {
+        offsets.clear();
+        return false;
+    }
+    line_count = header.lines;
+    return true;
+}
+
+void LineIndex::build(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    std::vector<char> block(read_block);
+    std::uint64_t position = 0;
+    std::uint64_t newlines = 0;
+    char last = '\n';
+    offsets.assign(1, 0);
+
+    // Line n + 1 starts after the n-th newline
+    for (;;)
+    {
+        ssize_t got = ::read(fd, block.data(), block.size());
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "read " + path);
+        }
+        if (got == 0)
+        {
+            break;
+        }
+
+        const char* begin = block.data();
+        const char* end = begin + got;
+        for (const char* p = begin;
+             (p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr; ++p)
+        {
+            if (++newlines % stride == 0)
+            {
+                offsets.push_back(position + (p - begin) + 1);
+            }
+        }
+        last = end[-1];
+        position += got;
+    }
+    ::close(fd);
+
+    // A final newline is not followed by a line
+    line_count = newlines + (last != '\n');
+    offsets.resize(indexed_lines(line_count));
+}
+
+void LineIndex::save(const std::string& index_path) const
+{
+    IndexHeader header;
+    std::memcpy(header.magic, index_magic, sizeof index_magic);
+    header.stride = stride;
+    header.size   = stamp.size;
+    header.sec    = stamp.sec;
+    header.nsec   = stamp.nsec;
+    header.lines  = line_count;
+    header.count  = offsets.size();
+
+    // A read-only directory only costs the next run another pass
+    replace_file(index_path, [&](std::ofstream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+        file.write(reinterpret_cast<const char*>(offsets.data()),
+                   offsets.size() * sizeof(std::uint64_t));
+    });
+}
+
+Checkpoint::Checkpoint(const std::string& path) : path(path + ".ckpt"), stamp(FileStamp::of(path))
+{
+}
+
+bool Checkpoint::load(LinePosition& next)
+{
+    std::ifstream file(path);
+    std::string word;
+    FileStamp input;
+    std::uint64_t last_case = 0;
+    std::uint64_t offset = 0;
+
+    // The newline after the offset tells a whole file from a cut one
+    if (!(file >> word) || word != "postfix_calc-checkpoint" ||
+        !(file >> word >> input.size) || word != "size" ||
+        !(file >> word >> input.sec >> input.nsec) || word != "mtime" ||
+        !(file >> word >> last_case) || word != "case" ||
+        !(file >> word >> offset) || word != "offset" || file.get() != '\n' ||
+        !(input == stamp) || offset > stamp.size)
+    {
+        return false;
+    }
+
+    next = LinePosition{last_case + 1, offset};
+    saved = next;
+    return true;
+}
+
+void Checkpoint::save(const LinePosition& next) const
+{
+    int error = replace_file(path, [&](std::ofstream& file) {
+        file << "postfix_calc-checkpoint\n"
+             << "size " << stamp.size << '\n'
+             << "mtime " << stamp.sec << ' ' << stamp.nsec << '\n'
+             << "case " << next.line - 1 << '\n'
+             << "offset " << next.offset << '\n';
+    });
+    if (error != 0)
+    {
+        throw std::system_error(error, std::generic_category(), "write " + path);
+    }
+}
+
+void Checkpoint::remove() const
+{
+    std::remove(path.c_str());
+}
@@ -0,0 +1,144 @@
+/// @file line_index.hpp
+/// @author Etienne Bravo
+///
+/// @brief Sidecar files that let a run over a large input file start in the
+/// middle: an index of line offsets, and a checkpoint of the last case
+/// written.
+
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/// Size and modification time of a file, a sidecar file made for another
+/// version of its input is not used.
+struct FileStamp {
+    std::uint64_t size  = 0;
+    std::int64_t  sec   = 0;  ///< modification time, seconds
+    std::int64_t  nsec  = 0;  ///< modification time, nanoseconds
+
+    /// @throws std::system_error if the file cannot be read.
+    static FileStamp of(const std::string& path);
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && sec == other.sec && nsec == other.nsec;
+    }
+};
+
+/// A line of a file and the offset of its first byte.
+struct LinePosition {
+    std::uint64_t line;    ///< line number, from 1
+    std::uint64_t offset;  ///< byte offset in the file
+};
+
+/// @brief Offsets of every stride-th line of a file, kept in FILE.idx.
+///
+/// The index is built in one pass over the file, searching for newlines
+/// with memchr(), and saved next to the file. Later runs load it instead as
+/// long as the file keeps the same size and modification time. To reach a
+/// line, seek to the indexed line before it and skip at most stride - 1
+/// lines, so the cost does not depend on the size of the file. Lines are
+/// counted like std::getline() counts them: a final newline does not start
+/// another line.
+///
+/// Example Usage:
+/// @code
+///   LineIndex index("input.txt");
+///   std::ifstream file("input.txt");
+///   index.seek(file, 5000000);  // the next getline() reads line 5000000
+/// @endcode
+
+class LineIndex {
+public:
+    /// Lines between two indexed lines.
+    static const std::uint64_t stride = 1024;
+
+    /// Loads the index of a file, or builds it if FILE.idx is missing or
+    /// stale. An index that cannot be saved is still used.
+    /// @param path The indexed file.
+    /// @throws std::system_error if the file cannot be read.
+    explicit LineIndex(const std::string& path);
+
+    /// @param line Line number, from 1.
+    /// @return The last indexed line at or before line.
+    LinePosition find(std::uint64_t line) const;
+
+    /// Moves a stream of the indexed file to the start of a line: seeks to
+    /// the indexed line before it, then reads the lines in between.
+    /// @param file The indexed file, opened for reading.
+    /// @param line Line number, from 1.
+    /// @return The line the file was moved to, before line if the file is
+    /// shorter.
+    LinePosition seek(std::istream& file, std::uint64_t line) const;
+
+    /// @return Number of lines of the file.
+    std::uint64_t lines() const { return line_count; }
+
+private:
+    bool load(const std::string& index_path);
+    void build(const std::string& path);
+    void save(const std::string& index_path) const;
+
+    FileStamp                  stamp;
+    std::uint64_t              line_count = 0;
+    std::vector<std::uint64_t> offsets;  ///< offset of line i * stride + 1
+};
+
+/// @brief Last case written by a run over a file, kept in FILE.ckpt.
+///
+/// The checkpoint is a short text file, replaced atomically with rename(),
+/// so a run that is killed leaves either the previous checkpoint or the new
+/// one. It also records the stamp of the input file and is ignored if the
+/// file has changed since.
+///
+/// Example Usage:
+/// @code
+///   Checkpoint checkpoint("input.txt");
+///   LinePosition next{1, 0};
+///   checkpoint.load(next);  // resume after the last saved case
+///   ...
+///   checkpoint.update(next);  // after the case before next is written
+/// @endcode
+
+class Checkpoint {
+public:
+    /// @param path The input file.
+    /// @throws std::system_error if the file cannot be read.
+    explicit Checkpoint(const std::string& path);
+
+    /// @param next Receives the line after the last case written.
+    /// @return False if there is no checkpoint for this version of the file,
+    /// or if it was cut short.
+    bool load(LinePosition& next);
+
+    /// Records that every case before next has been written.
+    /// @param next The first line that is not written yet.
+    /// @throws std::system_error if the checkpoint cannot be written.
+    void save(const LinePosition& next) const;
+
+    /// Saves next once every 65536 cases or 64 MiB of input, whichever
+    /// comes first.
+    /// @param next The first line that is not written yet.
+    void update(const LinePosition& next) {
+        if (next.line - saved.line >= save_cases || next.offset - saved.offset >= save_bytes) {
+            save(next);
+            saved = next;
+        }
+    }
+
+    /// Deletes the checkpoint, once the whole file is done.
+    void remove() const;
+
+private:
+    static const std::uint64_t save_cases = 1 << 16;
+    static const std::uint64_t save_bytes = 64 << 20;
+
+    std::string  path;  ///< of the checkpoint
+    FileStamp    stamp;
+    LinePosition saved{1, 0};  ///< last position saved or loaded
+};
+
+#endif // LINE_INDEX_HPP
@@ -0,0 +1,77 @@
+/// @file literal-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for parse_integer(). They cover literals shorter and
+/// longer than the eight digit SWAR step, the signs, the exact limits of
+/// each integer type and malformed literals.
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "literal.hpp"  // check include guard
+
+template <class Int>
+Int parse(const std::string& text) {
+    return parse_integer<Int>(text.data(), text.data() + text.size());
+}
+
+// Test short and long literals
+TEST_CASE("digits", "[literal]") {
+    SECTION("fewer digits than one SWAR step") {
+        CHECK(parse<int>("0") == 0);
+        CHECK(parse<int>("7") == 7);
+        CHECK(parse<int>("1234567") == 1234567);
+    }
+
+    SECTION("whole and partial SWAR steps") {
+        CHECK(parse<int>("12345678") == 12345678);
+        CHECK(parse<int>("123456789") == 123456789);
+        CHECK(parse<std::int64_t>("1234567890123456") == 1234567890123456LL);
+        CHECK(parse<std::int64_t>("00000000000000042") == 42);
+    }
+
+    SECTION("negative numbers") {
+        CHECK(parse<int>("-500") == -500);
+        CHECK(parse<int>("-0") == 0);
+        CHECK(parse<std::int64_t>("-1234567890123") == -1234567890123LL);
+    }
+}
+
+// Test the limits of each type
+TEST_CASE("overflow is exact", "[literal]") {
+    SECTION("int") {
+        CHECK(parse<int>("2147483647") == std::numeric_limits<int>::max());
+        CHECK(parse<int>("-2147483648") == std::numeric_limits<int>::min());
+        CHECK_THROWS_AS(parse<int>("2147483648"), std::out_of_range);
+        CHECK_THROWS_AS(parse<int>("-2147483649"), std::out_of_range);
+    }
+
+    SECTION("int64") {
+        CHECK(parse<std::int64_t>("9223372036854775807") == INT64_MAX);
+        CHECK(parse<std::int64_t>("-9223372036854775808") == INT64_MIN);
+        CHECK_THROWS_AS(parse<std::int64_t>("9223372036854775808"), std::out_of_range);
+        CHECK_THROWS_AS(parse<std::int64_t>("99999999999999999999"), std::out_of_range);
+    }
+
+    SECTION("int128") {
+        __int128 max = static_cast<__int128>(~static_cast<unsigned __int128>(0) >> 1);
+        CHECK(parse<__int128>("170141183460469231731687303715884105727") == max);
+        CHECK(parse<__int128>("-170141183460469231731687303715884105728") == -max - 1);
+        CHECK_THROWS_AS(parse<__int128>("170141183460469231731687303715884105728"),
+                        std::out_of_range);
+    }
+}
+
+// Test malformed literals
+TEST_CASE("invalid literals", "[literal]") {
+    CHECK_THROWS_AS(parse<int>(""), std::invalid_argument);
+    CHECK_THROWS_AS(parse<int>("-"), std::invalid_argument);
+    CHECK_THROWS_AS(parse<int>("12a4"), std::invalid_argument);
+    CHECK_THROWS_AS(parse<std::int64_t>("1234567x90"), std::invalid_argument);
+}
+
+/* EOF */
@@ -0,0 +1,118 @@
+/// @file literal.hpp
+/// @author Etienne Bravo
+///
+/// @brief Fast parsing of integer literals, eight digits at a time.
+
+#ifndef LITERAL_HPP
+#define LITERAL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace literal_detail {
+
+/// Loads eight characters as a little-endian 64 bit word.
+inline std::uint64_t load8(const char* p) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+/// Checks that all eight bytes of a word are '0' to '9'. Adding 6 to a digit
+/// keeps its high nibble at 3, any other byte changes one of the nibbles.
+inline bool is_eight_digits(std::uint64_t word) {
+    return ((word & 0xF0F0F0F0F0F0F0F0) |
+            (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+           0x3333333333333333;
+}
+
+/// Converts eight digit bytes to their value with three multiplications:
+/// pairs of digits are combined first, then pairs of pairs, then the halves.
+inline std::uint32_t parse_eight_digits(std::uint64_t word) {
+    const std::uint64_t mask = 0x000000FF000000FF;
+    const std::uint64_t mul1 = 100 + (1000000ULL << 32);
+    const std::uint64_t mul2 = 1 + (10000ULL << 32);
+
+    word -= 0x3030303030303030;
+    word = (word * 10) + (word >> 8);
+    word = (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+    return static_cast<std::uint32_t>(word);
+}
+
+} // namespace literal_detail
+
+/// @brief Parses a decimal integer literal with an optional leading '-'.
+///
+/// Replaces std::stoi and friends on the hot path: the characters are read in
+/// place, without copying the token into a std::string, without locale
+/// lookups, and eight digits are converted per step with SWAR arithmetic.
+/// Overflow is detected exactly, so the most negative value of Int is
+/// accepted and one past either end of its range is not.
+///
+/// @tparam Int Signed integer type, up to __int128.
+/// @param first First character of the literal.
+/// @param last One past the last character of the literal.
+/// @return Int The value of the literal.
+/// @throws std::invalid_argument if the literal has no digits or a character
+/// that is not a digit.
+/// @throws std::out_of_range if the value does not fit in Int.
+///
+/// Example Usage:
+/// @code
+///   const char* text = "-2147483648";
+///   int value = parse_integer<int>(text, text + 11); // INT_MIN
+/// @endcode
+
+template <class Int>
+Int parse_integer(const char* first, const char* last) {
+    using Unsigned = typename std::conditional<(sizeof(Int) > 8), unsigned __int128,
+                                               std::uint64_t>::type;
+    const Unsigned max = ~Unsigned(0) >> ((sizeof(Unsigned) - sizeof(Int)) * 8 + 1);
+
+    bool negative = first != last && *first == '-';
+    if (negative) {
+        ++first;
+    }
+    if (first == last) {
+        throw std::invalid_argument("invalid integer literal");
+    }
+
+    const Unsigned limit = max + (negative ? 1 : 0);
+    Unsigned value = 0;
+
+    while (last - first >= 8) {
+        std::uint64_t word = literal_detail::load8(first);
+        if (!literal_detail::is_eight_digits(word)) {
+            break;
+        }
+        std::uint32_t eight = literal_detail::parse_eight_digits(word);
+        if (value > (limit - eight) / 100000000) {
+            throw std::out_of_range("integer literal out of range");
+        }
+        value = value * 100000000 + eight;
+        first += 8;
+    }
+
+    for (; first != last; ++first) {
+        unsigned digit = static_cast<unsigned char>(*first) - '0';
+        if (digit > 9) {
+            throw std::invalid_argument("invalid integer literal");
+        }
+        if (value > (limit - digit) / 10) {
+            throw std::out_of_range("integer literal out of range");
+        }
+        value = value * 10 + digit;
+    }
+
+    if (negative && value != 0) {
+        return -static_cast<Int>(value - 1) - 1;
+    }
+    return static_cast<Int>(value);
+}
+
+#endif // LITERAL_HPP
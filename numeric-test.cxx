@@ -0,0 +1,137 @@
+/// @file numeric-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the numeric types of libpostfix: parsing,
+/// evaluating and printing int64, int128, double and Decimal values, integer
+/// results that wrap around, and the errors of results that do not fit.
+/// Build with
+///
+///   make lib && g++ -std=gnu++20 numeric-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "batch_eval.hpp"
+#include "numeric.hpp"  // check include guard
+#include "parallel_eval.hpp"
+#include "postfix.hpp"
+
+// Parses a literal like the evaluators do
+template <class Num>
+Num parse(const std::string& text) {
+    return Numeric<Num>::parse(text.data(), text.data() + text.size());
+}
+
+// Prints a value like the command line does
+template <class Num>
+std::string text(Num value) {
+    std::ostringstream out;
+    Numeric<Num>::write(out, value);
+    return out.str();
+}
+
+// Value of an Infix expression, printed, checked against its Postfix form
+template <class Num>
+std::string evaluate(const std::string& infix) {
+    std::string value = text(eval_infix<Num>(infix));
+    CHECK(text(eval_postfix<Num>(infix2postfix(infix))) == value);
+    return value;
+}
+
+// Test 64-bit integers
+TEST_CASE("int64", "[numeric]") {
+    CHECK(parse<std::int64_t>("-9223372036854775808") == INT64_MIN);
+    CHECK(text<std::int64_t>(INT64_MIN) == "-9223372036854775808");
+    CHECK(evaluate<std::int64_t>("3000000000 * 3") == "9000000000");
+    CHECK(evaluate<std::int64_t>("-9000000000 / 7 % 1000") == "-285");
+
+    CHECK_THROWS_AS(eval_infix<std::int64_t>("5 / 0"), std::domain_error);
+    CHECK_THROWS_AS(eval_infix<std::int64_t>("-9223372036854775808 / -1"), std::overflow_error);
+    CHECK_THROWS_AS(eval_infix<std::int64_t>("9223372036854775808 + 0"), std::out_of_range);
+}
+
+// Test 128-bit integers, which the standard library cannot print
+TEST_CASE("int128", "[numeric]") {
+    CHECK(text<__int128>(0) == "0");
+    CHECK(text<__int128>(-42) == "-42");
+    CHECK(text(parse<__int128>("-170141183460469231731687303715884105728")) ==
+          "-170141183460469231731687303715884105728");
+    CHECK(evaluate<__int128>("9223372036854775807 * 9223372036854775807") ==
+          "85070591730234615847396907784232501249");
+    CHECK(evaluate<__int128>("( 0 - 18446744073709551616 ) * 1000 / 3") == "-6148914691236517205333");
+
+    CHECK_THROWS_AS(eval_infix<__int128>("1 % 0"), std::domain_error);
+    CHECK_THROWS_AS(eval_infix<__int128>("-170141183460469231731687303715884105728 / -1"), std::overflow_error);
+}
+
+// Test floating point
+TEST_CASE("double", "[numeric]") {
+    CHECK(parse<double>("-12345678901234567890") == -12345678901234567890.0);
+    CHECK(evaluate<double>("10 / 4") == "2.5");
+    CHECK(evaluate<double>("1 / 3") == "0.333333333333333");
+    CHECK(evaluate<double>("-7 % 3") == "-1");
+    CHECK(evaluate<double>("1 / 0") == "inf");
+    CHECK(evaluate<double>("100000000000 * 100000000000") == "1e+22");
+}
+
+// Test fixed-point decimals
+TEST_CASE("decimal", "[numeric]") {
+    SECTION("values") {
+        CHECK(parse<Decimal>("5").raw == 50000);
+        CHECK(text(Decimal{-5}) == "-0.0005");
+        CHECK(evaluate<Decimal>("2 * 3") == "6.0000");
+        CHECK(evaluate<Decimal>("10 / 4") == "2.5000");
+        CHECK(evaluate<Decimal>("-7 / 2") == "-3.5000");
+        CHECK(evaluate<Decimal>("1 / 3") == "0.3333");
+        CHECK(evaluate<Decimal>("-1 / 3") == "-0.3333");
+        CHECK(evaluate<Decimal>("( 10 / 4 ) % 1") == "0.5000");
+        CHECK(evaluate<Decimal>("922337203685477 + 0") == "922337203685477.0000");
+    }
+
+    SECTION("results out of range throw") {
+        CHECK_THROWS_AS(eval_infix<Decimal>("100000000000000 * 100000"), std::overflow_error);
+        CHECK_THROWS_AS(eval_infix<Decimal>("922337203685477 + 1"), std::overflow_error);
+        CHECK_THROWS_AS(eval_infix<Decimal>("-922337203685477 - 2"), std::overflow_error);
+        CHECK_THROWS_AS(eval_infix<Decimal>("922337203685477 / ( 1 / 2 )"), std::overflow_error);
+        CHECK_THROWS_AS(eval_infix<Decimal>("-922337203685477 * -922337203685477"), std::overflow_error);
+        CHECK_THROWS_AS(eval_infix<Decimal>("922337203685478 + 0"), std::out_of_range);
+        CHECK_THROWS_AS(eval_infix<Decimal>("1 / 0"), std::domain_error);
+    }
+}
+
+// Test that integer sums, differences and products wrap around in every
+// evaluator, as the AVX2 lanes of ShapeBatch do
+TEST_CASE("wrap around", "[numeric]") {
+    SECTION("int") {
+        BatchEvaluator<int> batch;
+        struct Case {
+            const char* infix;
+            int         value;
+        };
+        for (Case c : {Case{"2147483647 + 1", INT32_MIN}, Case{"-2147483648 - 1", INT32_MAX},
+                       Case{"65536 * 65536", 0}, Case{"( 65536 + 1 ) * 65536 * 2", 131072},
+                       Case{"-2147483648 * -1", INT32_MIN}}) {
+            INFO(c.infix);
+            CHECK(evaluate<int>(c.infix) == std::to_string(c.value));
+            CHECK(eval_parallel<int>(c.infix, 2) == c.value);
+            EvalStatus status;
+            CHECK(batch.evaluate(c.infix, status) == c.value);
+            CHECK(status == EvalStatus::OK);
+        }
+    }
+
+    SECTION("int64 and int128") {
+        CHECK(evaluate<std::int64_t>("9223372036854775807 + 1") == "-9223372036854775808");
+        CHECK(evaluate<std::int64_t>("4294967296 * 4294967296") == "0");
+        CHECK(evaluate<__int128>("170141183460469231731687303715884105727 + 1") ==
+              "-170141183460469231731687303715884105728");
+        CHECK(evaluate<__int128>("-170141183460469231731687303715884105728 - 1") ==
+              "170141183460469231731687303715884105727");
+    }
+}
+
+/* EOF */
@@ -0,0 +1,239 @@
+/// @file numeric.hpp
+/// @author Etienne Bravo
+///
+/// @brief Numeric types supported by the calculator and the traits used by
+/// the evaluators to parse, compute and print them.
+
+#ifndef NUMERIC_HPP
+#define NUMERIC_HPP
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "literal.hpp"
+
+/// @brief Fixed-point decimal number with four digits after the point.
+///
+/// The value is stored as a 64-bit integer scaled by 10^4, so sums and
+/// differences are exact and products and quotients are truncated to four
+/// decimal places. Results are computed in 128 bits, and a result that does
+/// not fit the 64 bits throws std::overflow_error instead of wrapping.
+
+struct Decimal {
+    static constexpr int          places = 4;      ///< digits after the point
+    static constexpr std::int64_t scale  = 10000;  ///< 10^places
+
+    std::int64_t raw;  ///< value multiplied by scale
+};
+
+/// @param raw A result scaled by Decimal::scale.
+/// @return The Decimal of raw.
+/// @throws std::overflow_error if raw does not fit in 64 bits.
+inline Decimal checked_decimal(__int128 raw) {
+    if (raw > INT64_MAX || raw < INT64_MIN) {
+        throw std::overflow_error("decimal overflow");
+    }
+    return Decimal{static_cast<std::int64_t>(raw)};
+}
+
+inline Decimal operator+(Decimal a, Decimal b) { return checked_decimal(static_cast<__int128>(a.raw) + b.raw); }
+inline Decimal operator-(Decimal a, Decimal b) { return checked_decimal(static_cast<__int128>(a.raw) - b.raw); }
+
+inline Decimal operator*(Decimal a, Decimal b) {
+    return checked_decimal(static_cast<__int128>(a.raw) * b.raw / Decimal::scale);
+}
+
+inline Decimal operator/(Decimal a, Decimal b) {
+    return checked_decimal(static_cast<__int128>(a.raw) * Decimal::scale / b.raw);
+}
+
+inline Decimal operator%(Decimal a, Decimal b) { return Decimal{a.raw % b.raw}; }
+
+/// @brief Checks the operands of an integer division or remainder.
+///
+/// Dividing by zero, or the smallest value by -1, traps on x86 and would end
+/// the process with SIGFPE. Both are reported as exceptions instead, which a
+/// long running caller such as the shared memory server can catch.
+///
+/// @throws std::domain_error if b is zero.
+/// @throws std::overflow_error if a is the smallest value and b is -1.
+template <class Int>
+inline void check_division(Int a, Int b) {
+    if (b == 0) {
+        throw std::domain_error("division by zero");
+    }
+    if (b == -1 && a == std::numeric_limits<Int>::min()) {
+        throw std::overflow_error("division overflow");
+    }
+}
+
+/// @brief Sum, difference and product of two integers modulo 2^N.
+///
+/// Signed overflow is undefined behavior, so the operands are converted to
+/// the unsigned type, which wraps around, and the result back, which keeps
+/// its low bits since C++20. Overflowing results are those of the AVX2 lanes
+/// of ShapeBatch and of two's complement hardware.
+template <class Int>
+inline Int wrapping_add(Int a, Int b) {
+    using Unsigned = std::make_unsigned_t<Int>;
+    return static_cast<Int>(static_cast<Unsigned>(a) + static_cast<Unsigned>(b));
+}
+
+template <class Int>
+inline Int wrapping_subtract(Int a, Int b) {
+    using Unsigned = std::make_unsigned_t<Int>;
+    return static_cast<Int>(static_cast<Unsigned>(a) - static_cast<Unsigned>(b));
+}
+
+template <class Int>
+inline Int wrapping_multiply(Int a, Int b) {
+    using Unsigned = std::make_unsigned_t<Int>;
+    return static_cast<Int>(static_cast<Unsigned>(a) * static_cast<Unsigned>(b));
+}
+
+/// Numeric is a traits struct that gives each supported type its own parsing,
+/// arithmetic, division, remainder and printing code. The evaluators are templates over
+/// the numeric type, so the choice of type is made once and no runtime type
+/// dispatch happens per token. Only the specializations below are defined.
+///
+/// parse() reads a number token in place from the [first, last) range given
+/// by the Lexer.
+///
+/// @tparam T Numeric type of the operands and results.
+
+template <class T>
+struct Numeric;
+
+/// int, the default type. Matches the original behavior of the calculator,
+/// except that overflowing sums and products wrap around.
+template <>
+struct Numeric<int> {
+    static constexpr const char* name = "int";
+
+    static int  parse(const char* first, const char* last) {
+        return parse_integer<int>(first, last);
+    }
+    static int  add(int a, int b) { return wrapping_add(a, b); }
+    static int  subtract(int a, int b) { return wrapping_subtract(a, b); }
+    static int  multiply(int a, int b) { return wrapping_multiply(a, b); }
+    static int  divide(int a, int b) { check_division(a, b); return a / b; }
+    static int  remainder(int a, int b) { check_division(a, b); return a % b; }
+    static void write(std::ostream& os, int value) { os << value; }
+};
+
+/// 64-bit integers.
+template <>
+struct Numeric<std::int64_t> {
+    static constexpr const char* name = "int64";
+
+    static std::int64_t parse(const char* first, const char* last) {
+        return parse_integer<std::int64_t>(first, last);
+    }
+    static std::int64_t add(std::int64_t a, std::int64_t b) { return wrapping_add(a, b); }
+    static std::int64_t subtract(std::int64_t a, std::int64_t b) { return wrapping_subtract(a, b); }
+    static std::int64_t multiply(std::int64_t a, std::int64_t b) { return wrapping_multiply(a, b); }
+    static std::int64_t divide(std::int64_t a, std::int64_t b) { check_division(a, b); return a / b; }
+    static std::int64_t remainder(std::int64_t a, std::int64_t b) { check_division(a, b); return a % b; }
+    static void write(std::ostream& os, std::int64_t value) { os << value; }
+};
+
+/// 128-bit integers. The standard library cannot print them, so printing is
+/// done digit by digit.
+template <>
+struct Numeric<__int128> {
+    static constexpr const char* name = "int128";
+
+    static __int128 parse(const char* first, const char* last) {
+        return parse_integer<__int128>(first, last);
+    }
+
+    static __int128 add(__int128 a, __int128 b) { return wrapping_add(a, b); }
+    static __int128 subtract(__int128 a, __int128 b) { return wrapping_subtract(a, b); }
+    static __int128 multiply(__int128 a, __int128 b) { return wrapping_multiply(a, b); }
+    static __int128 divide(__int128 a, __int128 b) { check_division(a, b); return a / b; }
+    static __int128 remainder(__int128 a, __int128 b) { check_division(a, b); return a % b; }
+
+    static void write(std::ostream& os, __int128 value) {
+        char digits[41];
+        char* p = digits + sizeof(digits);
+        unsigned __int128 magnitude = value < 0 ? -static_cast<unsigned __int128>(value)
+                                                : static_cast<unsigned __int128>(value);
+        *--p = '\0';
+        do {
+            *--p = static_cast<char>('0' + static_cast<int>(magnitude % 10));
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (value < 0) {
+            *--p = '-';
+        }
+        os << p;
+    }
+};
+
+/// Double precision floating point. Division is not truncated and '%' is the
+/// floating point remainder.
+template <>
+struct Numeric<double> {
+    static constexpr const char* name = "double";
+
+    static double parse(const char* first, const char* last) {
+        double value;
+        std::from_chars_result result = std::from_chars(first, last, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            throw std::out_of_range("literal out of range");
+        }
+        if (result.ec != std::errc() || result.ptr != last) {
+            throw std::invalid_argument("invalid literal");
+        }
+        return value;
+    }
+    static double add(double a, double b) { return a + b; }
+    static double subtract(double a, double b) { return a - b; }
+    static double multiply(double a, double b) { return a * b; }
+    static double divide(double a, double b) { return a / b; }
+    static double remainder(double a, double b) { return std::fmod(a, b); }
+
+    static void write(std::ostream& os, double value) {
+        std::streamsize old_precision = os.precision(15);
+        os << value;
+        os.precision(old_precision);
+    }
+};
+
+/// Fixed-point decimal.
+template <>
+struct Numeric<Decimal> {
+    static constexpr const char* name = "decimal";
+
+    static Decimal parse(const char* first, const char* last) {
+        std::int64_t value = parse_integer<std::int64_t>(first, last);
+        if (value > INT64_MAX / Decimal::scale || value < INT64_MIN / Decimal::scale) {
+            throw std::out_of_range("integer literal out of range");
+        }
+        return Decimal{value * Decimal::scale};
+    }
+
+    static Decimal add(Decimal a, Decimal b) { return a + b; }
+    static Decimal subtract(Decimal a, Decimal b) { return a - b; }
+    static Decimal multiply(Decimal a, Decimal b) { return a * b; }
+    static Decimal divide(Decimal a, Decimal b) { check_division(a.raw, b.raw); return a / b; }
+    static Decimal remainder(Decimal a, Decimal b) { check_division(a.raw, b.raw); return a % b; }
+
+    static void write(std::ostream& os, Decimal value) {
+        std::uint64_t magnitude = value.raw < 0 ? -static_cast<std::uint64_t>(value.raw)
+                                                : static_cast<std::uint64_t>(value.raw);
+        std::string fraction = std::to_string(magnitude % Decimal::scale);
+        if (value.raw < 0) {
+            os << '-';
+        }
+        os << magnitude / Decimal::scale << '.'
+           << std::string(Decimal::places - fraction.size(), '0') << fraction;
+    }
+};
+
+#endif // NUMERIC_HPP
@@ -0,0 +1,169 @@
+/// @file parallel-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for eval_parallel(): the values and errors of
+/// eval_infix() for wide and deeply nested expressions split between
+/// threads, and for malformed expressions. Build with
+///
+///   make lib && g++ -std=gnu++20 parallel-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "numeric.hpp"
+#include "parallel_eval.hpp"  // check include guard
+#include "postfix.hpp"
+
+// Long enough for every thread to get a chunk of its own
+const std::size_t long_length = 600 * 1024;
+
+// Value of an expression, or the error it throws
+template <class Num, class Evaluate>
+std::string outcome(Evaluate evaluate) {
+    try {
+        std::ostringstream out;
+        Numeric<Num>::write(out, evaluate());
+        return out.str();
+    } catch (const std::exception& e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+template <class Num>
+void check_same(const std::string& infix, bool valid = false) {
+    std::string serial = outcome<Num>([&] { return eval_infix<Num>(infix); });
+    if (valid) {
+        REQUIRE(serial.compare(0, 6, "error:") != 0);
+    }
+    for (unsigned threads : {1u, 2u, 3u, 8u}) {
+        INFO(threads << " threads, " << infix.size() << " bytes: " << infix.substr(0, 60));
+        CHECK(outcome<Num>([&] { return eval_parallel<Num>(infix, threads); }) == serial);
+    }
+}
+
+// Random terms joined by random operators, with groups nested up to depth.
+// A '/' or '%' is followed by a literal, never by a group that could be 0.
+std::string random_expression(std::mt19937& random, std::size_t length, int depth) {
+    const char* ops[] = {" + ", " - ", " * ", " / ", " % "};
+    std::uniform_int_distribution<int> literal(1, 99);
+    std::string infix;
+    int open = 0;
+    std::size_t op = 0;
+    while (infix.size() < length) {
+        if (open < depth && op < 3 && random() % 4 == 0) {
+            infix += "( ";
+            ++open;
+        }
+        infix += std::to_string(random() % 2 ? literal(random) : -literal(random));
+        if (open > 0 && random() % 4 == 0) {
+            infix += " )";
+            --open;
+        }
+        op = random() % (infix.size() % 3 == 0 ? 5 : 3);  // few divisions
+        infix += ops[op];
+    }
+    infix += "1";
+    for (; open > 0; --open) {
+        infix += " )";
+    }
+    return infix;
+}
+
+// Test well formed expressions
+TEST_CASE("wide and deep", "[parallel]") {
+    std::mt19937 random(38);
+
+    SECTION("a flat sum of products") {
+        check_same<std::int64_t>(random_expression(random, long_length, 0), true);
+        check_same<double>(random_expression(random, long_length, 0), true);
+    }
+
+    SECTION("groups at every depth") {
+        check_same<std::int64_t>(random_expression(random, long_length, 3), true);
+        check_same<std::int64_t>(random_expression(random, long_length, 40), true);
+    }
+
+    SECTION("a product of groups, no top-level sum") {
+        std::string product = "( " + random_expression(random, long_length / 2, 4) + " ) * ( " +
+                              random_expression(random, long_length / 2, 4) + " ) % 1000003";
+        check_same<std::int64_t>(product, true);
+    }
+
+    SECTION("an expression enclosed in many groups") {
+        std::string open;
+        std::string close;
+        for (int i = 0; i < 1000; ++i) {
+            open += "( ";
+            close += " )";
+        }
+        check_same<std::int64_t>("  " + open + random_expression(random, long_length, 2) + close + "  ", true);
+    }
+
+    SECTION("a deep chain with a term at each level") {
+        std::string open;
+        std::string close;
+        while (open.size() < long_length) {
+            open += "( " + std::to_string(open.size() % 97 + 1) + " - ";
+            close += " )";
+        }
+        check_same<std::int64_t>(open + "1" + close + " * 3", true);
+    }
+
+    SECTION("int wraparound") {
+        std::string sum = "2147483647";
+        while (sum.size() < long_length) {
+            sum += " + 2147483647 * 3";
+        }
+        check_same<int>(sum, true);
+    }
+}
+
+// Test that malformed expressions fail like eval_infix()
+TEST_CASE("malformed", "[parallel]") {
+    std::mt19937 random(3);
+    std::string wide = random_expression(random, long_length, 2);
+    std::size_t middle = wide.find(" + ", wide.size() / 2);
+    REQUIRE(middle != std::string::npos);
+    REQUIRE_NOTHROW(eval_infix<int>(wide));
+
+    SECTION("two operands in a row") {
+        check_same<int>("1 + 2 3");
+        check_same<int>(wide + " 3");
+        check_same<int>(wide.substr(0, middle) + " 7" + wide.substr(middle));
+    }
+
+    SECTION("two operators in a row") {
+        check_same<int>(wide.substr(0, middle) + " *" + wide.substr(middle));
+        check_same<int>(wide + " +");
+        check_same<int>("* " + wide);
+    }
+
+    SECTION("unbalanced and empty groups") {
+        check_same<int>(wide + " )");
+        check_same<int>("( " + wide);
+        check_same<int>(") " + wide + " (");
+        check_same<int>(wide.substr(0, middle) + " + ( )" + wide.substr(middle));
+        check_same<int>(wide.substr(0, middle) + " ( 1 )" + wide.substr(middle));
+    }
+
+    SECTION("other characters") {
+        check_same<int>(wide.substr(0, middle) + " + x" + wide.substr(middle));
+    }
+
+    SECTION("no spaces to cut at") {
+        std::string packed;
+        while (packed.size() < long_length) {
+            packed += "1+";
+        }
+        check_same<int>(packed + "1");
+        check_same<int>(packed);
+    }
+}
+
+/* EOF */
@@ -0,0 +1,379 @@
+/// @file parallel_eval.cpp
+/// @author Etienne Bravo
+///
+/// @brief Depth prefix sums, top-level splitting and concurrent evaluation
+/// of the terms of eval_parallel().
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "alloc_track.hpp"
+#include "calculator.hpp"
+#include "char_class.hpp"
+#include "infix_reducer.hpp"
+#include "lexer.hpp"
+#include "numeric.hpp"
+#include "parallel_eval.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// Smallest chunk given to a thread, shorter ones are not worth a thread.
+const std::size_t min_chunk = 64 * 1024;
+
+/// Position that was not found.
+const std::size_t none = static_cast<std::size_t>(-1);
+
+/// A top-level term and the operator before it, 0 for the first term.
+template <class Num>
+struct Term {
+    char op;
+    Num  value;
+};
+
+/// What a well formed expression allows next: an operand, a number or '(',
+/// or an operator, a binary operator or ')'.
+enum Expect : unsigned char {
+    OPERAND,
+    OPERATOR,
+    MALFORMED,  ///< the tokens so far are not the start of an expression
+};
+
+/// Parenthesis counts and token order of one chunk.
+struct Depths {
+    long   delta  = 0;  ///< depth at the end of the chunk minus depth at its start
+    long   lowest = 0;  ///< lowest depth reached in the chunk, relative to its start
+    Expect after[2] = {MALFORMED, MALFORMED};  ///< state at the end, for each state at the start
+};
+
+/// Top-level operators of one chunk.
+struct Operators {
+    std::size_t low_first  = none;  ///< first '+' or '-'
+    std::size_t high_first = none;  ///< first '*', '/' or '%'
+};
+
+/// True if the byte at i is a binary '-': a '-' directly followed by a
+/// digit is the sign of a number, as in the Lexer.
+inline bool is_minus(const char* str, std::size_t i, std::size_t length) {
+    return str[i] == '-' && !(i + 1 < length && str[i + 1] >= '0' && str[i + 1] <= '9');
+}
+
+inline bool is_split(char c, bool low) {
+    return low ? (c == '+' || c == '-') : (c == '*' || c == '/' || c == '%');
+}
+
+/// @return The state after token, operands and operators must alternate.
+inline Expect next_state(Expect state, const Token& token) {
+    if (token.kind == Token::NUMBER) {
+        return state == OPERAND ? OPERATOR : MALFORMED;
+    }
+    switch (token.symbol()) {
+        case '(':
+            return state == OPERAND ? OPERAND : MALFORMED;
+        case ')':
+            return state == OPERATOR ? OPERATOR : MALFORMED;
+        case '+': case '-': case '*': case '/': case '%':
+            return state == OPERATOR ? OPERAND : MALFORMED;
+        default:
+            return MALFORMED;
+    }
+}
+
+/// Runs body(0) to body(n - 1), each on its own thread, and rethrows the
+/// first exception thrown by one of them.
+template <class Body>
+void run_parallel(unsigned n, Body body) {
+    std::vector<std::exception_ptr> errors(n);
+    std::vector<std::thread> workers;
+
+    for (unsigned i = 1; i < n; ++i) {
+        workers.emplace_back([&, i] {
+            try {
+                body(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    try {
+        body(0);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+template <class Num>
+Num apply(char op, Num a, Num b) {
+    switch (op) {
+        case '+': return Numeric<Num>::add(a, b);
+        case '-': return Numeric<Num>::subtract(a, b);
+        case '*': return Numeric<Num>::multiply(a, b);
+        case '/': return Numeric<Num>::divide(a, b);
+        default:  return Numeric<Num>::remainder(a, b);
+    }
+}
+
+/// Counts the parentheses of a chunk.
+inline Depths count_depths(const char* str, std::size_t length) {
+    Depths chunk;
+    long depth = 0;
+    for (std::size_t p = 0; p < length; ++p) {
+        depth += (str[p] == '(') - (str[p] == ')');
+        chunk.lowest = std::min(chunk.lowest, depth);
+    }
+    chunk.delta = depth;
+    return chunk;
+}
+
+/// Counts the parentheses of a chunk and follows its tokens from both
+/// states, the state at its start is not known yet. The chunk must start
+/// and end between tokens.
+inline Depths scan_tokens(const char* str, std::size_t length) {
+    CharClasses classes;
+    classify(str, length, classes);
+    Lexer lexer(str, classes);
+    Depths chunk;
+    Expect states[2] = {OPERAND, OPERATOR};
+    long depth = 0;
+
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next()) {
+        if (token.kind == Token::SYMBOL) {
+            depth += (token.symbol() == '(') - (token.symbol() == ')');
+            chunk.lowest = std::min(chunk.lowest, depth);
+        }
+        for (Expect& state : states) {
+            if (state != MALFORMED) {
+                state = next_state(state, token);
+            }
+        }
+    }
+    chunk.delta = depth;
+    chunk.after[OPERAND] = states[0];
+    chunk.after[OPERATOR] = states[1];
+    return chunk;
+}
+
+/// Evaluates [str, str + length) on the Calculator of the calling thread,
+/// like eval_infix().
+template <class Num>
+Num eval_serial(const char* str, std::size_t length) {
+    return Calculator<Num>::local().eval_infix(std::string_view(str, length));
+}
+
+/// Evaluates the terms of [str, str + length), a piece of the top level
+/// that starts with a term or with a split operator.
+/// @return False if a term is empty.
+template <class Num>
+bool eval_terms(const char* str, std::size_t length, bool low, std::vector<Term<Num>>& terms) {
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    InfixReducer<Num> reducer;
+    CharClasses classes;
+    classify(str, length, classes);
+    Lexer lexer(str, classes);
+    long depth = 0;
+    bool empty = true;
+    char op = 0;
+
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next()) {
+        if (token.kind == Token::NUMBER) {
+            reducer.push_value(Numeric<Num>::parse(token.first, token.last));
+            empty = false;
+            continue;
+        }
+
+        char c = token.symbol();
+        if (depth == 0 && is_split(c, low)) {
+            if (!empty) {
+                terms.push_back(Term<Num>{op, reducer.finish()});
+            } else if (op != 0 || !terms.empty()) {
+                return false;
+            }
+            op = c;
+            empty = true;
+            continue;
+        }
+
+        depth += (c == '(') - (c == ')');
+        reducer.push_operator(c);
+        empty = false;
+    }
+
+    if (empty) {
+        return op == 0 && terms.empty();
+    }
+    terms.push_back(Term<Num>{op, reducer.finish()});
+    return true;
+}
+
+/// Evaluates [str, str + length) with up to threads threads.
+/// @param checked True inside a group of an expression already checked, the
+/// token order is then not checked again.
+template <class Num>
+Num eval_range(const char* str, std::size_t length, unsigned threads, bool checked = false) {
+    // Surrounding whitespace would hide an enclosing group
+    while (length > 0 && str[0] == ' ') {
+        ++str;
+        --length;
+    }
+    while (length > 0 && str[length - 1] == ' ') {
+        --length;
+    }
+
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, length / min_chunk));
+    if (threads <= 1) {
+        return eval_serial<Num>(str, length);
+    }
+
+    // Chunks end at a space, a token is never cut in two
+    std::vector<std::size_t> bounds(threads + 1, 0);
+    for (unsigned i = 1; i < threads; ++i) {
+        std::size_t p = std::max(length / threads * i, bounds[i - 1]);
+        while (p < length && str[p] != ' ') {
+            ++p;
+        }
+        bounds[i] = p;
+    }
+    bounds[threads] = length;
+
+    // Pass 1: parenthesis counts and token order of each chunk
+    std::vector<Depths> depths(threads);
+    run_parallel(threads, [&](unsigned i) {
+        depths[i] = checked ? count_depths(str + bounds[i], bounds[i + 1] - bounds[i])
+                            : scan_tokens(str + bounds[i], bounds[i + 1] - bounds[i]);
+    });
+
+    // Prefix sum: depth and state at the start of each chunk. A malformed
+    // expression is evaluated whole, so it fails like eval_infix().
+    std::vector<long> start(threads + 1, 0);
+    Expect state = OPERAND;
+    for (unsigned i = 0; i < threads; ++i) {
+        if (start[i] + depths[i].lowest < 0) {
+            return eval_serial<Num>(str, length);  // unbalanced
+        }
+        start[i + 1] = start[i] + depths[i].delta;
+        if (!checked) {
+            state = depths[i].after[state];
+            if (state == MALFORMED) {
+                return eval_serial<Num>(str, length);
+            }
+        }
+    }
+    if (start[threads] != 0 || (!checked && state != OPERATOR)) {
+        return eval_serial<Num>(str, length);
+    }
+
+    // A '(' at depth 0 closes at the first byte where the depth is 0 again.
+    // Only the chunk where the depth first drops to 0 has to be scanned.
+    if (str[0] == '(') {
+        std::size_t close = none;
+        long depth = 0;
+        for (unsigned i = 0; i < threads && close == none; ++i) {
+            if (i > 0 && start[i] + depths[i].lowest > 0) {
+                continue;
+            }
+            depth = start[i];
+            for (std::size_t p = bounds[i]; p < bounds[i + 1]; ++p) {
+                depth += (str[p] == '(') - (str[p] == ')');
+                if (depth == 0) {
+                    close = p;
+                    break;
+                }
+            }
+        }
+        if (close == length - 1) {
+            return eval_range<Num>(str + 1, length - 2, threads, true);
+        }
+    }
+
+    // Pass 2: operators outside every parenthesis
+    std::vector<Operators> found(threads);
+    run_parallel(threads, [&](unsigned i) {
+        long depth = start[i];
+        Operators& ops = found[i];
+        for (std::size_t p = bounds[i]; p < bounds[i + 1]; ++p) {
+            char c = str[p];
+            if (c == '(' || c == ')') {
+                depth += (c == '(') - (c == ')');
+            } else if (depth != 0) {
+                continue;
+            } else if (c == '+' || is_minus(str, p, length)) {
+                ops.low_first = std::min(ops.low_first, p);
+            } else if ((c == '*' || c == '/' || c == '%') && ops.high_first == none) {
+                ops.high_first = p;
+            }
+        }
+    });
+
+    bool low = std::any_of(found.begin(), found.end(),
+                           [](const Operators& ops) { return ops.low_first != none; });
+
+    // Each piece runs from a split operator to the next chunk's first one
+    std::vector<std::size_t> cuts{0};
+    for (const Operators& ops : found) {
+        std::size_t first = low ? ops.low_first : ops.high_first;
+        if (first != none && first != 0) {
+            cuts.push_back(first);
+        }
+    }
+    if (cuts.size() == 1) {
+        return eval_serial<Num>(str, length);  // a single number or group
+    }
+    cuts.push_back(length);
+
+    // Pass 3: terms of each piece
+    unsigned pieces = static_cast<unsigned>(cuts.size() - 1);
+    std::vector<std::vector<Term<Num>>> terms(pieces);
+    std::vector<char> complete(pieces);
+    run_parallel(pieces, [&](unsigned i) {
+        complete[i] = eval_terms<Num>(str + cuts[i], cuts[i + 1] - cuts[i], low, terms[i]);
+    });
+
+    if (std::find(complete.begin(), complete.end(), 0) != complete.end() ||
+        terms[0].empty() || terms[0][0].op != 0) {
+        return eval_serial<Num>(str, length);  // missing operand
+    }
+
+    // Left to right, as the serial evaluators do
+    Num value = terms[0][0].value;
+    for (unsigned i = 0; i < pieces; ++i) {
+        for (std::size_t t = (i == 0); t < terms[i].size(); ++t) {
+            value = apply<Num>(terms[i][t].op, value, terms[i][t].value);
+        }
+    }
+    return value;
+}
+
+} // namespace
+
+template <class Num>
+Num eval_parallel(const std::string& infix, unsigned threads)
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    trace::Span span(trace::EVALUATE);
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return eval_range<Num>(infix.data(), infix.size(), threads);
+}
+
+// Parallel evaluators for the supported numeric types
+template int          eval_parallel<int>(const std::string &infix, unsigned threads);
+template std::int64_t eval_parallel<std::int64_t>(const std::string &infix, unsigned threads);
+template __int128     eval_parallel<__int128>(const std::string &infix, unsigned threads);
+template double       eval_parallel<double>(const std::string &infix, unsigned threads);
+template Decimal      eval_parallel<Decimal>(const std::string &infix, unsigned threads);
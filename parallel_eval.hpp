@@ -0,0 +1,48 @@
+/// @file parallel_eval.hpp
+/// @author Etienne Bravo
+///
+/// @brief Multithreaded evaluation of very long Infix expressions.
+
+#ifndef PARALLEL_EVAL_HPP
+#define PARALLEL_EVAL_HPP
+
+#include <string>
+
+/// @brief Evaluates an Infix expression with several threads.
+///
+/// Gives the same result as eval_infix(). The expression is cut at spaces
+/// into one chunk per thread and evaluated in three parallel passes:
+/// 1. Each thread counts the parentheses of its chunk and checks that its
+///    operands and operators alternate. A prefix sum of the counts gives the
+///    nesting depth at the start of every chunk, which is used to check the
+///    parentheses are balanced and to find the closing parenthesis of a
+///    group without scanning the whole expression. An expression enclosed
+///    in one group is unwrapped and evaluated again.
+/// 2. Each thread finds the operators of its chunk that are outside every
+///    parenthesis. The top level is split at '+' and '-', or at '*', '/'
+///    and '%' if it has no '+' or '-'.
+/// 3. Each thread evaluates the terms that follow the operators of its
+///    chunk with an InfixReducer.
+/// The values of the terms are then combined from left to right, so integer
+/// wraparound and floating point rounding are the same as in eval_infix().
+///
+/// Expressions shorter than 64 KiB per thread, malformed expressions, such
+/// as "1 + 2 3" or unbalanced ones, and expressions the passes cannot split
+/// are evaluated by a single thread, so they fail like eval_infix(). A top-level term is always
+/// evaluated by one thread, so "( huge ) * 2" gains from the unwrapping only.
+///
+/// @tparam Num Numeric type used for operands and results.
+/// @param infix The string containing the Infix expression.
+/// @param threads Number of threads, 0 for one per core.
+/// @return Num The value of the expression.
+///
+/// Example Usage:
+/// @code
+///   std::string sum = "1 + 2 * 3 + ...";  // megabytes long
+///   int result = eval_parallel(sum, 8);
+/// @endcode
+
+template <class Num = int>
+Num eval_parallel(const std::string& infix, unsigned threads = 0);
+
+#endif // PARALLEL_EVAL_HPP
@@ -0,0 +1,63 @@
+/// @file postfix.cpp
+/// @author Etienne Bravo
+///
+/// @brief Infix to Postfix conversion and the Postfix and single pass Infix
+/// evaluators, the core of libpostfix. They run on the Calculator of the
+/// calling thread.
+
+#include <cstdint>
+#include <string>
+#include "calculator.hpp"
+#include "char_class.hpp"
+#include "numeric.hpp"
+#include "postfix.hpp"
+
+// valid chars also include spaces
+bool containsOnlyValidChars(std::string const &str) {
+    // The bitmaps are kept per thread, a line allocates only when it is the longest yet
+    thread_local CharClasses classes;
+    return classify(str.data(), str.size(), classes);
+}
+
+int precedence(char op)
+{
+    if (op == '+' || op == '-')
+    {
+        return 1;
+    }
+    if (op == '*' || op == '/' || op == '%')
+    {
+        return 2;
+    }
+    return 0;
+}
+
+std::string infix2postfix(const std::string &infix)
+{
+    return std::string(Calculator<int>::local().to_postfix(infix));
+}
+
+template <class Num>
+Num eval_postfix(const std::string &postfix)
+{
+    return Calculator<Num>::local().eval_postfix(postfix);
+}
+
+template <class Num>
+Num eval_infix(const std::string &infix)
+{
+    return Calculator<Num>::local().eval_infix(infix);
+}
+
+// Evaluators for the supported numeric types
+template int          eval_postfix<int>(const std::string &postfix);
+template std::int64_t eval_postfix<std::int64_t>(const std::string &postfix);
+template __int128     eval_postfix<__int128>(const std::string &postfix);
+template double       eval_postfix<double>(const std::string &postfix);
+template Decimal      eval_postfix<Decimal>(const std::string &postfix);
+
+template int          eval_infix<int>(const std::string &infix);
+template std::int64_t eval_infix<std::int64_t>(const std::string &infix);
+template __int128     eval_infix<__int128>(const std::string &infix);
+template double       eval_infix<double>(const std::string &infix);
+template Decimal      eval_infix<Decimal>(const std::string &infix);
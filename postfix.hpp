@@ -0,0 +1,96 @@
+/// @file postfix.hpp
+/// @author Etienne Bravo
+///
+/// @brief Declarations of the infix to postfix conversion and evaluation
+/// functions shared by the calculator front ends.
+
+#ifndef POSTFIX_HPP
+#define POSTFIX_HPP
+
+#include <string>
+
+/// @brief Converts an Infix expression to a Postfix expression.
+///
+/// This function takes an Infix expression as input and converts it to
+/// its equivalent Postfix expression using a stack-based approach. The
+/// Infix expression should only contain operands, arithmetic operators
+/// (+, -, *, /, %), and parentheses. Operands and operators in the input
+/// string must be separated by at least one space.
+///
+/// @param infix The string containing the Infix expression.
+/// @return std::string A string containing the Postfix expression.
+///
+/// @note The function assumes that the Infix expression is well-formed
+/// and valid. Error handling for invalid expressions is not implemented.
+///
+/// Example Usage:
+/// @code
+///   std::string infix = "2 + 3 * 4";
+///   std::string postfix = infix2postfix(infix);
+///   std::cout << "Postfix: " << postfix << std::endl; // Outputs: 2 3 4 * +
+/// @endcode
+
+std::string infix2postfix(const std::string &infix);
+
+/// @brief Evaluates a Postfix expression and returns its value.
+///
+/// This function takes a Postfix expression as input and evaluates it to
+/// return its integer value. The Postfix expression should contain only
+/// integer operands and standard arithmetic operators (+, -, *, /). Each
+/// operand and operator in the input string must be separated by at least
+/// one space.
+///
+/// The evaluator is a template over the numeric type of the operands. It is
+/// instantiated for the types that have a Numeric specialization: int (the
+/// default), std::int64_t, __int128, double and Decimal.
+///
+/// @tparam Num Numeric type used for operands and results.
+/// @param postfix The string containing the Postfix expression.
+/// @return Num The value of the evaluated Postfix expression.
+/// @throws std::invalid_argument if an operator has fewer than two
+/// operands, or if operands are left over.
+///
+/// Example Usage:
+/// @code
+///   std::string postfix = "2 3 4 * +";
+///   int result = eval_postfix(postfix);
+///   std::cout << "Result: " << result << std::endl; // Outputs: 14
+///   double ratio = eval_postfix<double>("1 4 /"); // 0.25
+/// @endcode
+
+template <class Num = int>
+Num eval_postfix(const std::string &postfix);
+
+/// @brief Evaluates an Infix expression in a single pass.
+///
+/// Gives the same result as eval_postfix(infix2postfix(infix)) without
+/// building the Postfix string. The expression is tokenized once and every
+/// operator is applied to a value stack as soon as the precedence rules
+/// allow, see InfixReducer. infix2postfix() stays available for callers
+/// that need the Postfix text itself.
+///
+/// @tparam Num Numeric type used for operands and results.
+/// @param infix The string containing the Infix expression.
+/// @return Num The value of the expression.
+///
+/// Example Usage:
+/// @code
+///   int result = eval_infix("2 + 3 * 4");
+///   std::cout << "Result: " << result << std::endl; // Outputs: 14
+/// @endcode
+
+template <class Num = int>
+Num eval_infix(const std::string &infix);
+
+/// @brief Evaluates precedence of the entered operator
+/// @param op Operator
+/// @return precedence Determines precedence of the operator
+int precedence(char op);
+
+/// @brief Evaluates if the string contains only operators and numbers
+/// @param str string containing input
+/// @return true if it contains only numbers and valid operators
+/// @note This does not check for a valid format in the input. In the user we trust :D
+bool containsOnlyValidChars(std::string const &str);
+
+#endif // POSTFIX_HPP
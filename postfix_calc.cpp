@@ -6,94 +6,523 @@
 /// CSN Academic Integrity Policy while completing this assignment.
 
 #include <string>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
 #include <fstream>
 #include <iostream>
-#include <cctype>
-#include "Stack.hpp"
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include "alloc_track.hpp"
+#include "batch_reader.hpp"
+#include "calculator.hpp"
+#include "eval_limits.hpp"
+#include "line_index.hpp"
+#include "numeric.hpp"
+#include "parallel_eval.hpp"
+#include "postfix.hpp"
+#include "shape_batch.hpp"
+#include "shm_ring.hpp"
+#include "stream_eval.hpp"
+#include "trace.hpp"
 
-/// @brief Converts an Infix expression to a Postfix expression.
-///
-/// This function takes an Infix expression as input and converts it to
-/// its equivalent Postfix expression using a stack-based approach. The
-/// Infix expression should only contain operands, arithmetic operators
-/// (+, -, *, /, %), and parentheses. Operands and operators in the input
-/// string must be separated by at least one space.
-///
-/// @param infix The string containing the Infix expression.
-/// @return std::string A string containing the Postfix expression.
-///
-/// @note The function assumes that the Infix expression is well-formed
-/// and valid. Error handling for invalid expressions is not implemented.
-///
-/// Example Usage:
-/// @code
-///   std::string infix = "2 + 3 * 4";
-///   std::string postfix = infix2postfix(infix);
-///   std::cout << "Postfix: " << postfix << std::endl; // Outputs: 2 3 4 * +
-/// @endcode
+/// Command line options of the calculator.
+struct Options {
+    const char*              filename     = nullptr;  ///< input file, or nullptr for user input
+    std::vector<std::string> files;                   ///< input files of a batch
+    bool                     batch        = false;    ///< one output file per input file
+    std::string              out_dir;                 ///< directory of the batch outputs
+    bool                     io_threads   = false;    ///< read batches without io_uring
+    bool                     stream       = false;    ///< evaluate lines chunk by chunk
+    bool                     shapes       = false;    ///< group int lines by shape
+    bool                     rpn          = false;    ///< input lines are Postfix
+    unsigned                 parallel     = 0;        ///< threads per line, 0 for one
+    std::string              emit_postfix;            ///< file receiving the converted lines
+    bool                     cases        = false;    ///< evaluate a range of cases only
+    std::uint64_t            first_case   = 1;        ///< first case of the range
+    std::uint64_t            last_case    = UINT64_MAX;  ///< last case of the range
+    bool                     resume       = false;    ///< start after the checkpoint
+    bool                     alloc_report = false;    ///< print allocation counters at exit
+    std::string              trace;                   ///< Chrome trace file written at exit
+    unsigned long            trace_min    = 0;        ///< microseconds, faster lines are not traced
+    EvalLimits               limits;                  ///< cost limits of every line
+    bool                     limited      = false;    ///< some limit is set
+    std::string              shm_name;                ///< shared memory region to serve
+    unsigned                 shm_channels = 4;        ///< clients served at once
+    std::string              type         = "int";    ///< name of the numeric type
+};
 
-std::string infix2postfix(const std::string &infix);
+/// @brief Runs the calculator on a file, or interactively if no file is given.
+/// @tparam Num Numeric type used to evaluate the expressions.
+/// @param options Command line options.
+/// @return Exit code of the program.
+template <class Num>
+int calculate(const Options& options);
 
-/// @brief Evaluates a Postfix expression and returns its value.
-///
-/// This function takes a Postfix expression as input and evaluates it to
-/// return its integer value. The Postfix expression should contain only
-/// integer operands and standard arithmetic operators (+, -, *, /). Each
-/// operand and operator in the input string must be separated by at least
-/// one space.
+/// @brief Evaluates one line of input with the evaluator chosen by the options.
+/// @tparam Num Numeric type used to evaluate the expression.
+/// @param line Infix expression, or Postfix expression with --input=rpn.
+/// @param options Command line options.
+/// @param status Receives EvalStatus::OK, the limit the line exceeded, or
+/// EvalStatus::MALFORMED.
+/// @return Num The value of the expression, Num() if it exceeds a limit or
+/// is malformed.
+template <class Num>
+Num eval_line(const std::string& line, const Options& options, EvalStatus& status)
+{
+    status = EvalStatus::OK;
+    try {
+        if (options.rpn) {
+            return eval_postfix<Num>(line);
+        }
+        if (options.parallel != 0) {
+            return eval_parallel<Num>(line, options.parallel);
+        }
+        return eval_infix<Num>(line);
+    } catch (const LimitExceeded& e) {
+        status = e.status();
+        return Num();
+    } catch (const std::invalid_argument&) {
+        status = EvalStatus::MALFORMED;
+        return Num();
+    }
+}
+
+/// @brief Writes the result of a line, or the limit it exceeded.
+/// @tparam Num Numeric type of the result.
+/// @param out Stream receiving the result.
+/// @param ans The result.
+/// @param status The status given by eval_line().
+template <class Num>
+void write_result(std::ostream& out, const Num& ans, EvalStatus status)
+{
+    if (status != EvalStatus::OK) {
+        out << status_name(status);
+    } else {
+        Numeric<Num>::write(out, ans);
+    }
+}
+
+/// Most threads --parallel and --shm-channels may ask for.
+const unsigned long max_threads = 1024;
+
+/// @brief Reads the number of an option, such as N in "--parallel=N".
+/// @param digits The text after the '='.
+/// @param min Smallest value accepted.
+/// @param max Largest value accepted.
+/// @param value Receives the number.
+/// @return False if digits is not a decimal number from min to max.
+bool parse_number(const std::string& digits, unsigned long long min, unsigned long long max,
+                  unsigned long long& value);
+
+/// @brief Reads a limit: "--max-length=N", "--max-tokens=N", "--max-depth=N",
+/// "--max-stack=N" or "--max-time=US".
+/// @param arg The option.
+/// @param options Receives the limit.
+/// @return False if the option is unknown or N is not a positive number.
+bool parse_limit(const std::string& arg, Options& options);
+
+/// @brief Evaluates a batch of files, each into its own output file.
 ///
-/// @param postfix The string containing the Postfix expression.
-/// @return int The integer value of the evaluated Postfix expression.
+/// The files are read by a BatchReader, which keeps reads in flight while
+/// the files already read are evaluated. The results of input.txt go to
+/// input.txt.out, or to input.txt.out in the output directory if one is
+/// given, numbered from Case 1 in every file.
 ///
-/// @note The function assumes that the Postfix expression is well-formed
-/// and valid. Error handling for invalid expressions, such as division by
-/// zero or malformed inputs, is not implemented.
+/// A line that cannot be evaluated, malformed or dividing by zero, gets its
+/// error as its result, "Case N: division by zero", and the batch goes on
+/// with the next line.
 ///
-/// Example Usage:
-/// @code
-///   std::string postfix = "2 3 4 * +";
-///   int result = eval_postfix(postfix);
-///   std::cout << "Result: " << result << std::endl; // Outputs: 14
-/// @endcode
-
-int eval_postfix(const std::string &postfix);
-
-/// @brief Evaluates precedence of the entered operator
-/// @param op Operator
-/// @return precedence Determines precedence of the operator
-int precedence(char op);
-
-/// @brief Evaluates if the string contains only operators and numbers
-/// @param str string containing input
-/// @return true if it contains only numbers and valid operators
-/// @note This does not check for a valid format in the input. In the user we trust :D
-bool containsOnlyValidChars(std::string const &str);
+/// @tparam Num Numeric type used to evaluate the expressions.
+/// @param options Command line options.
+/// @return Exit code of the program.
+template <class Num>
+int calculate_files(const Options& options);
+
+/// @brief Path of the output file of an input file of a batch.
+/// @param input Path of the input file.
+/// @param out_dir Directory of the outputs, empty for next to the input.
+/// @return input.out, in out_dir if one is given.
+std::string output_path(const std::string& input, const std::string& out_dir);
+
+/// @brief Serves expressions written to a shared memory region until the
+/// process receives SIGINT or SIGTERM. See ShmServer.
+/// @tparam Num Numeric type used to evaluate the expressions.
+/// @param options Command line options.
+/// @return Exit code of the program.
+template <class Num>
+int serve(const Options& options);
+
+/// @brief Reads a range of cases: "A-B", "A-" for A to the end, or "A".
+/// @param text The range.
+/// @param options Receives the first and last case.
+/// @return False if the range is malformed.
+bool parse_cases(const std::string& text, Options& options);
+
+/// Number of lines given to a ShapeBatch at a time.
+const size_t shape_block = 1 << 16;
+
+/// @brief Evaluates the lines of a ShapeBatch and writes their results.
+/// @param batch Lines to evaluate, emptied on return.
+/// @param out Stream receiving one "Case N: " line per line.
+/// @param count Number of the first case, advanced past the last one.
+/// @param keep_going Writes the error of a line that throws as its result
+/// and goes on, instead of letting the exception through.
+void write_shapes(ShapeBatch& batch, std::ostream& out, size_t& count, bool keep_going = false);
 
 int main(int argc, char* argv[])
 {
+    Options options;
+    std::vector<std::string> inputs;
+
+    // Options start with "--", anything else is an input file
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--parallel") {
+            options.parallel = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg.compare(0, 11, "--parallel=") == 0) {
+            unsigned long long threads;
+            if (!parse_number(arg.substr(11), 1, max_threads, threads)) {
+                std::cerr << "Invalid thread count: " << arg << " (1 to " << max_threads << ")" << std::endl;
+                return 1;
+            }
+            options.parallel = static_cast<unsigned>(threads);
+        } else if (arg == "--shapes") {
+            options.shapes = true;
+        } else if (arg == "--alloc-report") {
+            options.alloc_report = true;
+        } else if (arg.compare(0, 7, "--type=") == 0) {
+            options.type = arg.substr(7);
+        } else if (arg.compare(0, 10, "--out-dir=") == 0) {
+            options.out_dir = arg.substr(10);
+        } else if (arg.compare(0, 12, "--shm-serve=") == 0) {
+            options.shm_name = arg.substr(12);
+        } else if (arg.compare(0, 15, "--shm-channels=") == 0) {
+            unsigned long long channels;
+            if (!parse_number(arg.substr(15), 1, max_threads, channels)) {
+                std::cerr << "Invalid channel count: " << arg << " (1 to " << max_threads << ")" << std::endl;
+                return 1;
+            }
+            options.shm_channels = static_cast<unsigned>(channels);
+        } else if (arg == "--input=rpn" || arg == "--input=infix") {
+            options.rpn = (arg == "--input=rpn");
+        } else if (arg == "--emit-postfix" && i + 1 < argc) {
+            options.emit_postfix = argv[++i];
+        } else if (arg.compare(0, 15, "--emit-postfix=") == 0) {
+            options.emit_postfix = arg.substr(15);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            options.trace = argv[++i];
+        } else if (arg.compare(0, 8, "--trace=") == 0) {
+            options.trace = arg.substr(8);
+        } else if (arg.compare(0, 12, "--trace-min=") == 0) {
+            unsigned long long micros;
+            if (!parse_number(arg.substr(12), 0, 999999999999, micros)) {
+                std::cerr << "Invalid trace threshold: " << arg << std::endl;
+                return 1;
+            }
+            options.trace_min = static_cast<unsigned long>(micros);
+        } else if (arg == "--cases" && i + 1 < argc) {
+            if (!parse_cases(argv[++i], options)) {
+                std::cerr << "Invalid case range: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 8, "--cases=") == 0) {
+            if (!parse_cases(arg.substr(8), options)) {
+                std::cerr << "Invalid case range: " << arg.substr(8) << std::endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 6, "--max-") == 0) {
+            if (!parse_limit(arg, options)) {
+                std::cerr << "Invalid limit: " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--io=threads") {
+            options.io_threads = true;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    // Several files, a directory or a pattern make a batch
+    if (!inputs.empty()) {
+        options.files = expand_inputs(inputs);
+        options.batch = inputs.size() > 1 || options.files.size() != 1 ||
+                        options.files[0] != inputs[0] || !options.out_dir.empty();
+        options.filename = options.files.empty() ? inputs[0].c_str() : options.files[0].c_str();
+    }
+
+    // Two inputs with the same output would overwrite each other
+    if (options.batch) {
+        std::map<std::string, std::string> outputs;
+        for (const std::string& file : options.files) {
+            auto inserted = outputs.emplace(output_path(file, options.out_dir), file);
+            if (!inserted.second) {
+                std::cerr << file << " and " << inserted.first->second << " would both be written to "
+                          << inserted.first->first << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Postfix lines skip the Infix engines, and only Infix files can be exported
+    if (options.rpn && (options.stream || options.shapes || options.parallel != 0)) {
+        std::cerr << "--input=rpn cannot be used with --stream, --shapes or --parallel" << std::endl;
+        return 1;
+    }
+    if (!options.emit_postfix.empty() &&
+        (options.rpn || options.stream || options.shapes || options.batch ||
+         options.filename == nullptr || !options.shm_name.empty())) {
+        std::cerr << "--emit-postfix needs a single Infix input file" << std::endl;
+        return 1;
+    }
+
+    // Ranges and checkpoints need line offsets, known only for a single file read line by line
+    if ((options.cases || options.resume) &&
+        (options.stream || options.batch || options.filename == nullptr ||
+         !options.emit_postfix.empty() || !options.shm_name.empty())) {
+        std::cerr << "--cases and --resume need a single input file, without --stream or --emit-postfix"
+                  << std::endl;
+        return 1;
+    }
+    if (options.cases && options.resume) {
+        std::cerr << "--cases cannot be used with --resume" << std::endl;
+        return 1;
+    }
+
+    // The limits are checked by the Calculator, which these engines do not use
+    if (options.limited && (options.stream || options.shapes || options.parallel != 0)) {
+        std::cerr << "--max-length, --max-tokens, --max-depth, --max-stack and --max-time cannot be used with "
+                     "--stream, --shapes or --parallel" << std::endl;
+        return 1;
+    }
+
+    if (options.alloc_report) {
+        alloc_track::enable();
+    }
+
+    // Opened first, a long run is not wasted on a path that cannot be written
+    std::ofstream traceFile;
+    if (!options.trace.empty()) {
+        traceFile.open(options.trace);
+        if (!traceFile) {
+            std::cerr << "Unable to create file " << options.trace << std::endl;
+            return 1;
+        }
+        trace::enable(true, options.trace_min * 1000);
+    }
+
+    const std::string& type = options.type;
+    int status;
+
+    // The numeric type is chosen once, each type has its own evaluator
+    if (type == Numeric<int>::name) {
+        status = calculate<int>(options);
+    } else if (type == Numeric<std::int64_t>::name) {
+        status = calculate<std::int64_t>(options);
+    } else if (type == Numeric<__int128>::name) {
+        status = calculate<__int128>(options);
+    } else if (type == Numeric<double>::name) {
+        status = calculate<double>(options);
+    } else if (type == Numeric<Decimal>::name) {
+        status = calculate<Decimal>(options);
+    } else {
+        std::cerr << "Unknown numeric type: " << type << std::endl;
+        return 1;
+    }
+
+    if (traceFile.is_open()) {
+        trace::write(traceFile);
+    }
+    return status;
+}
+
+template <class Num>
+int calculate(const Options& options)
+{
+    if (!options.shm_name.empty()) {
+        return serve<Num>(options);
+    }
+
+    if (options.batch) {
+        return calculate_files<Num>(options);
+    }
+
+    const char* filename = options.filename;
     std::string input;
-    std::string postfix;
-    int ans;
+    Num ans;
+    EvalStatus status;
     size_t count = 1;
+    Calculator<Num>::local().set_limits(options.limits);
 
-    if (argc > 1) {
-        std::ifstream inputFile(argv[1]); // Open the file
+    if (filename != nullptr) {
+        std::ifstream inputFile(filename); // Open the file
         if (!inputFile)
         {
             std::cerr << "Unable to open file input.txt";
             return 1; // Return an error code
         }
 
-        while (std::getline(inputFile, input))
+        // Later runs start where this one stops
+        std::optional<Checkpoint> checkpoint;
+        if (options.resume)
         {
-            postfix = infix2postfix(input);
-            ans = eval_postfix(postfix);
-            std::cout << "Case " << count << ": " << ans << std::endl;
-            count++;
+            checkpoint.emplace(filename);
+        }
+
+        // Start at the first case of the range, or after the last checkpoint
+        LinePosition start{1, 0};
+        if (options.cases)
+        {
+            start = LineIndex(filename).seek(inputFile, options.first_case);
+        }
+        else if (checkpoint && checkpoint->load(start))
+        {
+            inputFile.seekg(start.offset);
+        }
+        std::uint64_t offset = start.offset;
+        count = start.line;
+
+        // Lines of the same shape are evaluated together, int only
+        if (options.shapes && std::is_same<Num, int>::value)
+        {
+            ShapeBatch batch;
+            while (count + batch.size() <= options.last_case && std::getline(inputFile, input))
+            {
+                batch.add(input);
+                offset += input.size() + 1;
+                if (batch.size() == shape_block)
+                {
+                    write_shapes(batch, std::cout, count);
+                    if (checkpoint)
+                    {
+                        checkpoint->update(LinePosition{count, offset});
+                    }
+                }
+            }
+            write_shapes(batch, std::cout, count);
+        }
+
+        // Lines are evaluated chunk by chunk, never stored whole
+        else if (options.stream)
+        {
+            StreamEvaluator<Num> engine;
+            while (true)
+            {
+                trace::LineScope line(count);
+                bool read;
+                {
+                    trace::Span span(trace::EVALUATE);
+                    read = engine.read_line(inputFile, ans);
+                }
+                if (!read)
+                {
+                    line.cancel();  // end of the file
+                    break;
+                }
+
+                trace::Span span(trace::WRITE);
+                std::cout << "Case " << count << ": ";
+                Numeric<Num>::write(std::cout, ans);
+                std::cout << std::endl;
+                count++;
+            }
+        }
+
+        // Every line is converted once, stored and evaluated in Postfix form
+        else if (!options.emit_postfix.empty())
+        {
+            std::ofstream postfixFile(options.emit_postfix);
+            if (!postfixFile)
+            {
+                std::cerr << "Unable to create file " << options.emit_postfix << std::endl;
+                return 1;
+            }
+
+            // The Postfix text stays in the calculator, it is never copied
+            Calculator<Num>& calculator = Calculator<Num>::local();
+            while (std::getline(inputFile, input))
+            {
+                trace::LineScope line(count, input);
+                status = EvalStatus::OK;
+                bool converted = false;
+                try
+                {
+                    std::string_view postfix = calculator.to_postfix(input);
+                    if (!postfix.empty())
+                    {
+                        postfix.remove_suffix(1);  // trailing space
+                    }
+                    postfixFile << postfix << '\n';
+                    converted = true;
+                    ans = calculator.eval_postfix(postfix);
+                }
+                catch (const LimitExceeded& e)
+                {
+                    status = e.status();
+                    if (!converted)
+                    {
+                        postfixFile << '\n';  // the lines stay aligned
+                    }
+                }
+                catch (const std::invalid_argument&)
+                {
+                    status = EvalStatus::MALFORMED;
+                    if (!converted)
+                    {
+                        postfixFile << '\n';
+                    }
+                }
+                trace::Span span(trace::WRITE);
+                std::cout << "Case " << count << ": ";
+                write_result(std::cout, ans, status);
+                std::cout << std::endl;
+                count++;
+            }
+        }
+
+        else
+        {
+            while (count <= options.last_case && std::getline(inputFile, input))
+            {
+                trace::LineScope line(count, input);
+                ans = eval_line<Num>(input, options, status);
+                trace::Span span(trace::WRITE);
+                std::cout << "Case " << count << ": ";
+                write_result(std::cout, ans, status);
+                std::cout << std::endl;
+                count++;
+
+                offset += input.size() + 1;
+                if (checkpoint)
+                {
+                    checkpoint->update(LinePosition{count, offset});
+                }
+            }
+        }
+
+        // The whole file is done, the next run starts over
+        if (checkpoint)
+        {
+            checkpoint->remove();
         }
 
         inputFile.close();
+
+        if (options.alloc_report) {
+            alloc_track::report(std::cerr, count - 1);
+        }
     } 
     
     else {
@@ -120,10 +549,11 @@ int main(int argc, char* argv[])
 
             // Evaluate formula
             else if (containsOnlyValidChars(input)) {
-                postfix = infix2postfix(input);
-                ans = eval_postfix(postfix);
+                ans = eval_line<Num>(input, options, status);
                 std::cout << "YOU ENTERED: " << input << std::endl;
-                std::cout << "RESULT: " << ans << std::endl;
+                std::cout << "RESULT: ";
+                write_result(std::cout, ans, status);
+                std::cout << std::endl;
             }
 
             // invalid input 
@@ -137,134 +567,275 @@ int main(int argc, char* argv[])
     return 0;
 }
 
-// valid chars also include spaces
-bool containsOnlyValidChars(std::string const &str) {
-    return str.find_first_not_of(" 1234567890()+-/*%") ==
-        std::string::npos;
-}
-
-int precedence(char op)
+template <class Num>
+int calculate_files(const Options& options)
 {
-    if (op == '+' || op == '-')
-    {
-        return 1;
-    }
-    if (op == '*' || op == '/' || op == '%')
-    {
-        return 2;
-    }
-    return 0;
-}
+    BatchReader reader(options.files, !options.io_threads);
+    Calculator<Num>::local().set_limits(options.limits);
+    bool shapes = options.shapes && std::is_same<Num, int>::value;
+    ShapeBatch batch;
+    FileData file;
+    std::string input;
+    size_t total = 0;
+    int status = 0;
 
-std::string infix2postfix(const std::string &infix)
-{
-    std::string postfix;
-    Stack<char> stack;
+    while (reader.next(file))
+    {
+        if (file.error != 0)
+        {
+            std::cerr << "Unable to open file " << file.path << ": "
+                      << std::strerror(file.error) << std::endl;
+            status = 1;
+            continue;
+        }
 
-    std::istringstream iss(infix);
-    char token;
+        std::string name = output_path(file.path, options.out_dir);
+        std::ofstream outputFile(name);
+        if (!outputFile)
+        {
+            std::cerr << "Unable to create file " << name << std::endl;
+            status = 1;
+            continue;
+        }
 
-    // populate string
-    while (iss >> token)
-    {
-        // Numbers and negative numbers
-        if (std::isdigit(token) || (token == '-' && isdigit(iss.peek())) )
+        // Same lines as std::getline, a final newline does not start a line
+        size_t count = 1;
+        size_t start = 0;
+        while (start < file.contents.size())
         {
-            std::string number;
-            if (token == '-')
+            size_t end = file.contents.find('\n', start);
+            if (end == std::string::npos)
             {
-                number += token;
-                iss >> token;
+                end = file.contents.size();
             }
-            while (std::isdigit(token))
+            input.assign(file.contents, start, end - start);
+            start = end + 1;
+
+            if (shapes)
             {
-                number += token;
-                if (!(iss >> token))
-                    break;
+                batch.add(input);
+                if (batch.size() == shape_block)
+                {
+                    write_shapes(batch, outputFile, count, true);
+                }
+                continue;
             }
-            iss.putback(token);
-            postfix += number + ' ';
-        }
 
-        // Open parenthesis
-        else if (token == '(')
-        {
-            stack.push(token);
+            // One bad line does not end the batch, its error is its result
+            trace::LineScope line(count, input);
+            EvalStatus lineStatus;
+            Num ans = Num();
+            std::string error;
+            try
+            {
+                ans = eval_line<Num>(input, options, lineStatus);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+            trace::Span span(trace::WRITE);
+            outputFile << "Case " << count << ": ";
+            if (!error.empty())
+            {
+                outputFile << error;
+            }
+            else
+            {
+                write_result(outputFile, ans, lineStatus);
+            }
+            outputFile << '\n';
+            count++;
         }
+        write_shapes(batch, outputFile, count, true);
+        total += count - 1;
+    }
 
-        // If close parenthesis
-        else if (token == ')')
-        {
-            while (!stack.empty() && stack.top() != '(')
+    if (options.alloc_report) {
+        alloc_track::report(std::cerr, total);
+    }
+
+    return status;
+}
+
+template <class Num>
+int serve(const Options& options)
+{
+    // The workers inherit the blocked signals, only sigwait() receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try
+    {
+        ShmServer server(options.shm_name, options.shm_channels,
+                         [&options](const std::string& expression, std::string& result) {
+            if (!containsOnlyValidChars(expression))
             {
-                postfix += stack.top();
-                postfix += ' ';
-                stack.pop();
+                result = "Invalid character was found.";
+                return false;
             }
-            stack.pop();
-        }
 
-        // If operator is found
-        else
-        {
-            while (!stack.empty() && precedence(token) <= precedence(stack.top()))
+            // Requests are numbered per channel, each channel has its own thread
+            thread_local std::ostringstream out;
+            thread_local size_t requests = 0;
+            if (requests == 0)
             {
-                postfix += stack.top();
-                postfix += ' ';
-                stack.pop();
+                Calculator<Num>::local().set_limits(options.limits);
             }
-            stack.push(token);
-        }
+            trace::LineScope line(++requests, expression);
+
+            EvalStatus status;
+            Num ans = eval_line<Num>(expression, options, status);
+            if (status != EvalStatus::OK)
+            {
+                result = status_name(status);
+                return false;
+            }
+            out.str("");
+            Numeric<Num>::write(out, ans);
+            result = out.str();
+            return true;
+        });
+
+        std::cerr << "Serving " << options.shm_name << " with " << options.shm_channels
+                  << " channels" << std::endl;
+
+        int signal;
+        sigwait(&signals, &signal);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
-    // clear the stack when input ends
-    while (!stack.empty())
+    return 0;
+}
+
+std::string output_path(const std::string& input, const std::string& out_dir)
+{
+    if (out_dir.empty())
     {
-        postfix += stack.top();
-        postfix += ' ';
-        stack.pop();
+        return input + ".out";
     }
+    return out_dir + '/' + input.substr(input.find_last_of('/') + 1) + ".out";
+}
 
-    return postfix;
+bool parse_number(const std::string& digits, unsigned long long min, unsigned long long max,
+                  unsigned long long& value)
+{
+    // At most 18 digits, std::stoull cannot overflow
+    if (digits.empty() || digits.size() > 18 || digits.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+    value = std::stoull(digits);
+    return value >= min && value <= max;
 }
 
-int eval_postfix(const std::string &postfix)
+bool parse_limit(const std::string& arg, Options& options)
 {
-    Stack<int> stack;
-    std::istringstream iss(postfix);
-    std::string token;
+    size_t equals = arg.find('=');
+    std::string name = arg.substr(0, equals);
+    unsigned long long value;
+    if (equals == std::string::npos || !parse_number(arg.substr(equals + 1), 1, 999999999999, value))
+    {
+        return false;
+    }
 
-    while (iss >> token) {
-        if (std::isdigit(token[0]) || (token[0] == '-' && token.length() > 1)) {
-            stack.push(std::stoi(token));
-        } else {
-            int operand1 = stack.top();
-            stack.pop();
-            int operand2 = stack.top();
-            stack.pop();
-
-            switch (token[0]) {
-                case '+':
-                    stack.push(operand2 + operand1);
-                    break;
-                case '-':
-                    stack.push(operand2 - operand1);
-                    break;
-                case '*':
-                    stack.push(operand2 * operand1);
-                    break;
-                case '/':
-                    stack.push(operand2 / operand1);
-                    break;
-                case '%':
-                    stack.push(operand2 % operand1);
-                    break;
-                default:
-                    std::cerr << "Unknown operator: " << token[0] << std::endl;
-                    break;
-            }
+    if (name == "--max-length")
+    {
+        options.limits.max_length = value;
+    }
+    else if (name == "--max-tokens")
+    {
+        options.limits.max_tokens = value;
+    }
+    else if (name == "--max-depth")
+    {
+        options.limits.max_depth = value;
+    }
+    else if (name == "--max-stack")
+    {
+        options.limits.max_stack = value;
+    }
+    else if (name == "--max-time")
+    {
+        options.limits.max_time = std::chrono::microseconds(value);
+    }
+    else
+    {
+        return false;
+    }
+    options.limited = true;
+    return true;
+}
+
+bool parse_cases(const std::string& text, Options& options)
+{
+    size_t dash = text.find('-');
+    std::string first = text.substr(0, dash);
+    std::string last = dash == std::string::npos ? first : text.substr(dash + 1);
+
+    auto number = [](const std::string& digits, std::uint64_t& value) {
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
         }
+        value = std::stoull(digits);
+        return value != 0;
+    };
+
+    options.last_case = UINT64_MAX;
+    if (!number(first, options.first_case) || (!last.empty() && !number(last, options.last_case)) ||
+        options.last_case < options.first_case)
+    {
+        return false;
     }
+    options.cases = true;
+    return true;
+}
 
-    return stack.top();
-}
\ No newline at end of file
+void write_shapes(ShapeBatch& batch, std::ostream& out, size_t& count, bool keep_going)
+{
+    {
+        trace::Span span(trace::EVALUATE);
+        batch.evaluate();
+    }
+
+    // Cases before a line that throws are still written
+    trace::Span span(trace::WRITE);
+    try
+    {
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            out << "Case " << count << ": ";
+            if (!keep_going)
+            {
+                out << batch.result(i) << '\n';
+            }
+            else
+            {
+                try
+                {
+                    out << batch.result(i) << '\n';
+                }
+                catch (const std::exception& e)
+                {
+                    out << e.what() << '\n';
+                }
+            }
+            count++;
+        }
+    }
+    catch (...)
+    {
+        out.flush();
+        throw;
+    }
+    out.flush();
+    batch.clear();
+}
@@ -0,0 +1,154 @@
+/// @file reader-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the BatchReader class and expand_inputs(): the
+/// io_uring and thread backends deliver the same files, the fallback of
+/// kernels without io_uring opens, and the outputs of an earlier batch left
+/// out of the inputs. Build with
+///
+///   make lib && g++ -std=gnu++20 reader-test.cxx libpostfix.a -pthread -lrt
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "batch_reader.hpp"  // check include guard
+
+// Temporary directory of input files, removed with its contents
+struct InputDir {
+    std::string path;
+
+    InputDir() {
+        char name[] = "/tmp/reader-test-XXXXXX";
+        REQUIRE(::mkdtemp(name) != nullptr);
+        path = name;
+    }
+
+    ~InputDir() { std::filesystem::remove_all(path); }
+
+    std::string write(const std::string& name, const std::string& contents) {
+        std::string file = path + '/' + name;
+        std::ofstream(file, std::ios::binary) << contents;
+        return file;
+    }
+};
+
+// Files delivered by a reader, in the order of the list it was given
+std::vector<FileData> read_all(BatchReader& reader) {
+    std::vector<FileData> files;
+    FileData file;
+    while (reader.next(file)) {
+        files.push_back(file);
+    }
+    std::sort(files.begin(), files.end(),
+              [](const FileData& a, const FileData& b) { return a.index < b.index; });
+    return files;
+}
+
+// Every file once, with the contents it was written with
+void check_files(const std::vector<FileData>& files, const std::vector<std::string>& paths,
+                 const std::vector<std::string>& contents) {
+    REQUIRE(files.size() == paths.size());
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        CHECK(files[i].index == i);
+        CHECK(files[i].path == paths[i]);
+        if (contents[i] == "missing") {
+            CHECK(files[i].error == ENOENT);
+            CHECK(files[i].contents.empty());
+        } else {
+            CHECK(files[i].error == 0);
+            CHECK(files[i].contents == contents[i]);
+        }
+    }
+}
+
+// Test the inputs of a batch
+TEST_CASE("expand_inputs", "[reader]") {
+    InputDir dir;
+    std::string b = dir.write("b.txt", "1 + 2\n");
+    std::string a = dir.write("a.txt", "3 * 4\n");
+    dir.write("a.txt.out", "Case 1: 12\n");
+    dir.write("c.out", "Case 1: 3\n");
+    std::filesystem::create_directory(dir.path + "/sub");
+
+    SECTION("a directory gives its files sorted by name, without outputs") {
+        CHECK(expand_inputs({dir.path}) == std::vector<std::string>{a, b});
+    }
+
+    SECTION("a pattern leaves out the outputs it matches") {
+        CHECK(expand_inputs({dir.path + "/a*"}) == std::vector<std::string>{a});
+        CHECK(expand_inputs({dir.path + "/*.out"}).empty());
+    }
+
+    SECTION("other arguments are kept as they are") {
+        std::vector<std::string> args{dir.path + "/c.out", b, dir.path + "/missing.txt"};
+        CHECK(expand_inputs(args) == args);
+    }
+}
+
+// Test that every backend reads the same files
+TEST_CASE("backends", "[reader]") {
+    InputDir dir;
+    std::string large;
+    while (large.size() < 300 * 1024) {
+        large += "( 1 + 2 ) * 3\n";
+    }
+
+    std::vector<std::string> names{"empty.txt", "a.txt", "large.txt", "missing.txt", "no-newline.txt"};
+    std::vector<std::string> contents{"", "1 + 2\n3 * 4\n", large, "missing", "7 - 2"};
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (contents[i] == "missing") {
+            paths.push_back(dir.path + '/' + names[i]);
+        } else {
+            paths.push_back(dir.write(names[i], contents[i]));
+        }
+    }
+    dir.write("a.txt.out", "Case 1: 3\n");
+
+    std::vector<std::string> inputs = expand_inputs({dir.path});
+    CHECK(std::find(inputs.begin(), inputs.end(), dir.path + "/a.txt.out") == inputs.end());
+
+    SECTION("threads") {
+        BatchReader reader(paths, false, 2);
+        CHECK(std::string(reader.backend_name()) == "threads");
+        check_files(read_all(reader), paths, contents);
+    }
+
+    SECTION("io_uring") {
+        BatchReader reader(paths, true, 2);
+        if (std::string(reader.backend_name()) != "io_uring") {
+            WARN("io_uring is not available, the thread backend was tested twice");
+        }
+        check_files(read_all(reader), paths, contents);
+    }
+
+    SECTION("io_uring without opens falls back to blocking reads") {
+        BatchReader::emulate_old_kernel(true);
+        BatchReader reader(paths, true, 2);
+        BatchReader::emulate_old_kernel(false);
+        check_files(read_all(reader), paths, contents);
+    }
+
+    SECTION("more files than the depth, in list order") {
+        std::vector<std::string> many;
+        std::vector<std::string> expected;
+        for (int i = 0; i < 40; ++i) {
+            std::string text = std::to_string(i) + " + 1\n";
+            many.push_back(dir.write("many-" + std::to_string(i) + ".txt", text));
+            expected.push_back(text);
+        }
+        BatchReader uring(many, true, 4);
+        BatchReader threads(many, false, 4);
+        check_files(read_all(uring), many, expected);
+        check_files(read_all(threads), many, expected);
+    }
+}
+
+/* EOF */
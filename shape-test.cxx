@@ -0,0 +1,139 @@
+/// @file shape-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the ShapeBatch class of libpostfix: the lane
+/// kernel and the scalar path give the results of eval_infix<int>() for
+/// mixed shapes, groups that do not fill their last lanes and lanes that
+/// cannot be divided. Build with
+///
+///   make lib && g++ -std=gnu++20 shape-test.cxx libpostfix.a -pthread -lrt
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "postfix.hpp"
+#include "shape_batch.hpp"  // check include guard
+
+// Value of an expression, or the error it throws
+template <class Evaluate>
+std::string outcome(Evaluate evaluate) {
+    try {
+        return std::to_string(evaluate());
+    } catch (const std::exception& e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+// Checks every line through the lanes and through the scalar path alone
+void check_batch(const std::vector<std::string>& lines) {
+    ShapeBatch vector;
+    ShapeBatch scalar;
+    for (const std::string& line : lines) {
+        vector.add(line);
+        scalar.add(line);
+    }
+    vector.evaluate();  // scalar is never evaluated, every line runs its program alone
+
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        INFO("line " << i << ": " << lines[i] << " (" << ShapeBatch::kernel() << ")");
+        std::string expected = outcome([&] { return eval_infix<int>(lines[i]); });
+        CHECK(outcome([&] { return vector.result(i); }) == expected);
+        CHECK(outcome([&] { return scalar.result(i); }) == expected);
+    }
+}
+
+// Lines of a few shapes, interleaved, with small random literals
+std::vector<std::string> mixed_lines(std::size_t count, std::uint32_t seed) {
+    const char* shapes[] = {"( a + b ) * c", "a - b * c + d", "a * ( b - ( c + d ) ) / e",
+                            "a % b + c", "( ( a ) )", "a / b - c % d"};
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> literal(-999, 999);
+
+    std::vector<std::string> lines;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string line;
+        for (const char* c = shapes[random() % 6]; *c != '\0'; ++c) {
+            if (*c >= 'a' && *c <= 'e') {
+                int value = literal(random);
+                line += std::to_string(value == 0 ? 1 : value);  // divisions by zero are tested below
+            } else {
+                line += *c;
+            }
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Test the values of well formed lines
+TEST_CASE("mixed shapes", "[shape]") {
+    SECTION("groups of every size around a lane width") {
+        for (std::size_t count : {1, 7, 8, 9, 15, 16, 17, 50, 301}) {
+            check_batch(mixed_lines(count, static_cast<std::uint32_t>(count)));
+        }
+    }
+
+    SECTION("one shape with a tail shorter than the lanes") {
+        std::vector<std::string> lines;
+        for (std::size_t i = 0; i < 2 * ShapeBatch::lanes + 3; ++i) {
+            lines.push_back("( " + std::to_string(i) + " + 2 ) * -3");
+        }
+        check_batch(lines);
+
+        ShapeBatch batch;
+        for (const std::string& line : lines) {
+            batch.add(line);
+        }
+        CHECK(batch.groups() == 1);
+    }
+
+    SECTION("deeper than the lane stack") {
+        std::string deep = "1";
+        for (int i = 0; i < 70; ++i) {
+            deep = "( " + std::to_string(i) + " - " + deep + " )";
+        }
+        check_batch(std::vector<std::string>(ShapeBatch::lanes + 1, deep));
+    }
+}
+
+// Test the lanes the vector code leaves to the scalar path
+TEST_CASE("edge lanes", "[shape]") {
+    std::vector<std::string> lines;
+    for (std::size_t i = 0; i < 3 * ShapeBatch::lanes + 5; ++i) {
+        switch (i % 5) {
+            case 0:
+                lines.push_back("7 / 0");
+                break;
+            case 1:
+                lines.push_back("-2147483648 / -1");
+                break;
+            case 2:
+                lines.push_back("-2147483648 % -1");
+                break;
+            case 3:
+                lines.push_back("9 % 0");
+                break;
+            default:
+                lines.push_back(std::to_string(i) + " / -" + std::to_string(i % 7 + 1));
+                break;
+        }
+    }
+
+    SECTION("errors do not spill into the other lanes") {
+        check_batch(lines);
+    }
+
+    SECTION("with lines that do not compile") {
+        lines.insert(lines.begin() + 3, "1 + 2 3");
+        lines.insert(lines.begin() + 11, "( 1 + 2");
+        lines.insert(lines.begin() + 12, "99999999999 + 1");
+        check_batch(lines);
+    }
+}
+
+/* EOF */
@@ -0,0 +1,340 @@
+/// @file shape_batch.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the ShapeBatch class: compilation of lines to
+/// Postfix programs, the AVX2 lane kernel and the scalar path.
+
+#include <climits>
+#include <stdexcept>
+#include "alloc_track.hpp"
+#include "lexer.hpp"
+#include "numeric.hpp"
+#include "postfix.hpp"
+#include "shape_batch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHAPE_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/// Deeper programs take the scalar path, the lane stack lives in registers
+/// and on the machine stack.
+const std::size_t max_depth = 64;
+
+#ifdef SHAPE_BATCH_X86
+
+// Truncating int32 division through doubles. Every int32 quotient is exact
+// after truncation, the rounding error of the double division is smaller
+// than the distance of a non integer quotient to the next integer.
+__attribute__((target("avx2")))
+inline __m256i divide_lanes(__m256i a, __m256i b) {
+    __m256d a_low  = _mm256_cvtepi32_pd(_mm256_castsi256_si128(a));
+    __m256d a_high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1));
+    __m256d b_low  = _mm256_cvtepi32_pd(_mm256_castsi256_si128(b));
+    __m256d b_high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1));
+
+    __m128i low  = _mm256_cvttpd_epi32(_mm256_div_pd(a_low, b_low));
+    __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(a_high, b_high));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+// Runs a program on eight lines. Returns a mask of the lanes that divide
+// by zero or divide INT_MIN by -1, their results must be discarded.
+__attribute__((target("avx2")))
+unsigned run_lanes(const std::string& program, const std::int32_t* values, std::int32_t* results) {
+    __m256i stack[max_depth];
+    __m256i* top = stack;  // one past the top value
+    __m256i bad = _mm256_setzero_si256();
+    const __m256i* literal = reinterpret_cast<const __m256i*>(values);
+
+    for (char c : program) {
+        if (c == 'n') {
+            *top++ = _mm256_loadu_si256(literal++);
+            continue;
+        }
+
+        __m256i b = *--top;
+        __m256i a = top[-1];
+
+        switch (c) {
+            case '+':
+                top[-1] = _mm256_add_epi32(a, b);
+                break;
+            case '-':
+                top[-1] = _mm256_sub_epi32(a, b);
+                break;
+            case '*':
+                top[-1] = _mm256_mullo_epi32(a, b);
+                break;
+            default: {
+                // '/' and '%', lanes that would trap divide by 1 instead
+                __m256i zero = _mm256_cmpeq_epi32(b, _mm256_setzero_si256());
+                __m256i overflow = _mm256_and_si256(_mm256_cmpeq_epi32(a, _mm256_set1_epi32(INT_MIN)),
+                                                    _mm256_cmpeq_epi32(b, _mm256_set1_epi32(-1)));
+                __m256i skip = _mm256_or_si256(zero, overflow);
+                bad = _mm256_or_si256(bad, skip);
+                b = _mm256_blendv_epi8(b, _mm256_set1_epi32(1), skip);
+
+                __m256i quotient = divide_lanes(a, b);
+                top[-1] = c == '/' ? quotient
+                                   : _mm256_sub_epi32(a, _mm256_mullo_epi32(quotient, b));
+                break;
+            }
+        }
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(results), stack[0]);
+    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(bad)));
+}
+
+#endif // SHAPE_BATCH_X86
+
+bool has_avx2() {
+#ifdef SHAPE_BATCH_X86
+    static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return supported;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+void ShapeBatch::add(const std::string& line)
+{
+    alloc_track::PhaseScope phase(alloc_track::CONVERT);
+    Line entry{};
+    bool compiled;
+
+    // Literals out of range throw, eval_infix() reports them later
+    try
+    {
+        compiled = compile(line);
+    }
+    catch (const std::exception&)
+    {
+        compiled = false;
+    }
+
+    if (!compiled)
+    {
+        entry.state = TEXT;
+        entry.member = texts.size();
+        texts.push_back(line);
+        lines.push_back(entry);
+        return;
+    }
+
+    auto found = index.emplace(program, shapes.size());
+    if (found.second)
+    {
+        shapes.push_back(Group{program, literal.size(), depth, {}, {}});
+    }
+
+    Group& group = shapes[found.first->second];
+    std::size_t member = group.members.size();
+    if (member % lanes == 0)
+    {
+        group.values.resize(group.values.size() + lanes * group.literals);
+    }
+    for (std::size_t k = 0; k < group.literals; ++k)
+    {
+        value(group, member, k) = literal[k];
+    }
+    group.members.push_back(lines.size());
+
+    entry.state = SCALAR;
+    entry.group = static_cast<std::uint32_t>(found.first->second);
+    entry.member = member;
+    lines.push_back(entry);
+}
+
+void ShapeBatch::evaluate()
+{
+#ifdef SHAPE_BATCH_X86
+    if (!has_avx2())
+    {
+        return;
+    }
+
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    std::int32_t results[lanes];
+
+    for (Group& group : shapes)
+    {
+        if (group.depth > max_depth)
+        {
+            continue;
+        }
+
+        std::size_t full = group.members.size() / lanes;
+        for (std::size_t block = 0; block < full; ++block)
+        {
+            unsigned bad = run_lanes(group.program, &group.values[block * group.literals * lanes], results);
+
+            for (std::size_t lane = 0; lane < lanes; ++lane)
+            {
+                if (!((bad >> lane) & 1))
+                {
+                    Line& entry = lines[group.members[block * lanes + lane]];
+                    entry.state = READY;
+                    entry.value = results[lane];
+                }
+            }
+        }
+    }
+#endif
+}
+
+int ShapeBatch::result(std::size_t line)
+{
+    const Line& entry = lines[line];
+
+    switch (entry.state) {
+        case READY:
+            return entry.value;
+        case SCALAR:
+            return run_scalar(shapes[entry.group], entry.member);
+        default:
+            return eval_infix<int>(texts[entry.member]);
+    }
+}
+
+void ShapeBatch::clear()
+{
+    shapes.clear();
+    index.clear();
+    lines.clear();
+    texts.clear();
+}
+
+const char* ShapeBatch::kernel()
+{
+    return has_avx2() ? "avx2" : "scalar";
+}
+
+int ShapeBatch::run_scalar(Group& group, std::size_t member)
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    std::size_t k = 0;
+    scratch.clear();
+
+    for (char c : group.program)
+    {
+        if (c == 'n')
+        {
+            scratch.push_back(value(group, member, k++));
+            continue;
+        }
+
+        int operand1 = scratch.back();
+        scratch.pop_back();
+        int& operand2 = scratch.back();
+
+        switch (c) {
+            case '+':
+                operand2 = Numeric<int>::add(operand2, operand1);
+                break;
+            case '-':
+                operand2 = Numeric<int>::subtract(operand2, operand1);
+                break;
+            case '*':
+                operand2 = Numeric<int>::multiply(operand2, operand1);
+                break;
+            case '/':
+                operand2 = Numeric<int>::divide(operand2, operand1);
+                break;
+            default:
+                operand2 = Numeric<int>::remainder(operand2, operand1);
+                break;
+        }
+    }
+
+    return scratch.back();
+}
+
+bool ShapeBatch::compile(const std::string& line)
+{
+    std::size_t values = 0;
+    program.clear();
+    literal.clear();
+    pending.clear();
+    depth = 0;
+
+    // Emits an operator, which needs two values
+    auto emit = [&](char op) {
+        if (values < 2)
+        {
+            return false;
+        }
+        --values;
+        program += op;
+        return true;
+    };
+
+    classify(line.data(), line.size(), classes);
+    Lexer lexer(line.data(), classes);
+
+    // Same rules as InfixReducer, anything it would not accept is rejected
+    for (Token token = lexer.next(); token.kind != Token::END; token = lexer.next())
+    {
+        if (token.kind == Token::NUMBER)
+        {
+            literal.push_back(Numeric<int>::parse(token.first, token.last));
+            program += 'n';
+            if (++values > depth)
+            {
+                depth = values;
+            }
+        }
+        else if (token.symbol() == '(')
+        {
+            pending += '(';
+        }
+        else if (token.symbol() == ')')
+        {
+            while (!pending.empty() && pending.back() != '(')
+            {
+                if (!emit(pending.back()))
+                {
+                    return false;
+                }
+                pending.pop_back();
+            }
+            if (pending.empty())
+            {
+                return false;
+            }
+            pending.pop_back();
+        }
+        else if (precedence(token.symbol()) > 0)
+        {
+            while (!pending.empty() && precedence(token.symbol()) <= precedence(pending.back()))
+            {
+                if (!emit(pending.back()))
+                {
+                    return false;
+                }
+                pending.pop_back();
+            }
+            pending += token.symbol();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (!pending.empty())
+    {
+        if (pending.back() == '(' || !emit(pending.back()))
+        {
+            return false;
+        }
+        pending.pop_back();
+    }
+
+    return values == 1;
+}
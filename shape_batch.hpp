@@ -0,0 +1,127 @@
+/// @file shape_batch.hpp
+/// @author Etienne Bravo
+///
+/// @brief Batch evaluation of int expressions grouped by the shape of their
+/// Postfix form, eight lines at a time in AVX2 lanes.
+
+#ifndef SHAPE_BATCH_HPP
+#define SHAPE_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "char_class.hpp"
+
+/// @brief Evaluates many lines that share a few operator and parenthesis
+/// structures, such as generated test files.
+///
+/// Every line added is compiled to its Postfix program. The shape of the
+/// program is the Postfix string with each number replaced by 'n', so
+/// "( 1 + 2 ) * 3" and "( 40 + -5 ) * 6" both have the shape "nn+n*". Lines
+/// of the same shape form a group, and evaluate() runs the program of each
+/// group once for every eight of its lines, one line per 32-bit lane of an
+/// AVX2 register. The literals of a group are stored lane by lane, so each
+/// number of the program is a single vector load.
+///
+/// The results are the ones eval_infix<int>() gives. Lines the vector code
+/// cannot handle are evaluated one by one when their result is asked for:
+/// - the last lines of a group that do not fill eight lanes,
+/// - lanes that divide by zero or divide INT_MIN by -1,
+/// - lines that do not compile: malformed expressions, unknown symbols and
+///   literals out of range are given to eval_infix<int>() itself, so they
+///   fail the same way as in main.
+///
+/// Without AVX2 every line takes the scalar path.
+///
+/// Example Usage:
+/// @code
+///   ShapeBatch batch;
+///   for (const std::string& line : lines) batch.add(line);
+///   batch.evaluate();
+///   for (std::size_t i = 0; i < batch.size(); ++i) std::cout << batch.result(i);
+/// @endcode
+
+class ShapeBatch {
+public:
+    /// Number of lines evaluated together.
+    static constexpr std::size_t lanes = 8;
+
+    /// Compiles a line and adds it to the group of its shape.
+    /// @param line Infix expression.
+    void add(const std::string& line);
+
+    /// Evaluates every full set of eight lines of every group.
+    void evaluate();
+
+    /// Gives the value of a line. Lines left to the scalar path are evaluated
+    /// here, so results should be asked for in order.
+    /// @param line Position of the line, in the order of add().
+    /// @return The value of the expression.
+    int result(std::size_t line);
+
+    /// @return Number of lines added since the last clear().
+    std::size_t size() const { return lines.size(); }
+
+    /// @return Number of distinct shapes.
+    std::size_t groups() const { return shapes.size(); }
+
+    /// Removes every line and every group.
+    void clear();
+
+    /// @return "avx2" or "scalar", the kernel used by evaluate().
+    static const char* kernel();
+
+private:
+    /// Lines of one shape.
+    struct Group {
+        std::string                program;   ///< Postfix shape, 'n' for numbers
+        std::size_t                literals;  ///< numbers in the program
+        std::size_t                depth;     ///< largest value stack depth
+        std::vector<std::size_t>   members;   ///< positions of the lines
+        std::vector<std::int32_t>  values;    ///< literals, see value()
+    };
+
+    /// How the result of a line is found.
+    enum State : unsigned char {
+        READY,   ///< computed by evaluate()
+        SCALAR,  ///< run the group program on this line alone
+        TEXT,    ///< did not compile, eval_infix() is given the text
+    };
+
+    /// Where a line is and how it is evaluated.
+    struct Line {
+        State         state;
+        std::uint32_t group;   ///< group of a compiled line
+        std::size_t   member;  ///< index in the group, or in texts for TEXT
+        std::int32_t  value;   ///< result of a READY line
+    };
+
+    /// Literals are stored in blocks of lanes members: literal k of member m
+    /// is at ((m / lanes) * literals + k) * lanes + m % lanes.
+    static std::int32_t& value(Group& group, std::size_t member, std::size_t k) {
+        return group.values[((member / lanes) * group.literals + k) * lanes + member % lanes];
+    }
+
+    /// Runs the program of a group on one of its members.
+    int run_scalar(Group& group, std::size_t member);
+
+    /// Compiles a line into program and literal, the members of this
+    /// object reused between lines.
+    /// @return False if the line is not a well formed expression.
+    bool compile(const std::string& line);
+
+    std::vector<Group>                           shapes;
+    std::unordered_map<std::string, std::size_t> index;     ///< group of each program
+    std::vector<Line>                            lines;
+    std::vector<std::string>                     texts;     ///< lines that did not compile
+    std::string                                  program;   ///< program being compiled
+    std::vector<std::int32_t>                    literal;   ///< its literals
+    std::string                                  pending;   ///< its operator stack
+    std::size_t                                  depth = 0; ///< its value stack depth
+    CharClasses                                  classes;   ///< bitmaps of the line
+    std::vector<std::int32_t>                    scratch;   ///< value stack of run_scalar()
+};
+
+#endif // SHAPE_BATCH_HPP
@@ -0,0 +1,190 @@
+/// @file shm-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the ShmServer and ShmClient classes of libpostfix:
+/// pipelined requests around the ring many times, a round trip through
+/// postfix_calc --shm-serve, and channels and regions left by processes
+/// that died. Build with
+///
+///   make && g++ -std=gnu++20 shm-test.cxx libpostfix.a -pthread -lrt
+///
+/// and run it from the directory of postfix_calc.
+
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "postfix.hpp"
+#include "shm_ring.hpp"  // check include guard
+
+// Region name of this process, so tests running at once do not collide
+std::string region_name(const char* test) {
+    return "/shm-test-" + std::to_string(::getpid()) + "-" + test;
+}
+
+// Evaluates Infix expressions, like --shm-serve
+bool evaluate_infix(const std::string& expression, std::string& result) {
+    result = std::to_string(eval_infix(expression));
+    return true;
+}
+
+// Test the ring protocol
+TEST_CASE("ring", "[shm]") {
+    std::string name = region_name("ring");
+    ShmServer server(name, 2, evaluate_infix);
+    ShmClient client(name);
+
+    SECTION("one request at a time, around the ring") {
+        for (int i = 0; i < 3 * static_cast<int>(shm::ring_slots) + 5; ++i) {
+            CHECK(client.evaluate(std::to_string(i) + " * 2") == std::to_string(2 * i));
+        }
+        CHECK(client.pending() == 0);
+    }
+
+    SECTION("full rings, pipelined") {
+        std::string result;
+        for (int round = 0; round < 5; ++round) {
+            for (std::size_t i = 0; i < ShmClient::capacity(); ++i) {
+                client.submit(std::to_string(round) + " + " + std::to_string(i));
+            }
+            CHECK(client.pending() == ShmClient::capacity());
+            CHECK_THROWS_AS(client.submit("1"), std::out_of_range);
+
+            for (std::size_t i = 0; i < ShmClient::capacity(); ++i) {
+                REQUIRE(client.receive(result));
+                CHECK(result == std::to_string(round + static_cast<int>(i)));
+            }
+            CHECK_THROWS_AS(client.receive(result), std::out_of_range);
+        }
+    }
+
+    SECTION("a ring that is never empty, the slots wrap while in use") {
+        std::string result;
+        int next = 0;
+        int expected = 0;
+        for (; next < 10; ++next) {
+            client.submit(std::to_string(next));
+        }
+        for (; next < 10 * static_cast<int>(shm::ring_slots); ++next) {
+            client.submit(std::to_string(next));
+            REQUIRE(client.receive(result));
+            CHECK(result == std::to_string(expected++));
+        }
+        while (client.pending() != 0) {
+            REQUIRE(client.receive(result));
+            CHECK(result == std::to_string(expected++));
+        }
+        CHECK(expected == next);
+    }
+
+    SECTION("errors and oversized expressions") {
+        CHECK_THROWS_WITH(client.evaluate("1 / 0"), "division by zero");
+        CHECK(client.evaluate("6 * 7") == "42");
+        CHECK_THROWS_AS(client.submit(std::string(sizeof(shm::Slot::text) + 1, '1')), std::length_error);
+        CHECK(client.pending() == 0);
+    }
+}
+
+// Test a round trip through the --shm-serve mode of postfix_calc
+TEST_CASE("postfix_calc --shm-serve", "[shm]") {
+    REQUIRE(std::filesystem::exists("postfix_calc"));
+    std::string name = region_name("serve");
+    std::string serve = "--shm-serve=" + name;
+
+    pid_t server = ::fork();
+    REQUIRE(server >= 0);
+    if (server == 0) {
+        ::dup2(::open("/dev/null", O_WRONLY), 2);  // "Serving ..."
+        ::execl("./postfix_calc", "postfix_calc", serve.c_str(), "--shm-channels=2", "--max-tokens=9",
+                "--type=int64", static_cast<char*>(nullptr));
+        ::_exit(127);
+    }
+
+    // The region appears once the server is ready
+    std::unique_ptr<ShmClient> client;
+    for (int tries = 0; client == nullptr && tries < 500; ++tries) {
+        try {
+            client = std::make_unique<ShmClient>(name);
+        } catch (const std::exception&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    REQUIRE(client != nullptr);
+
+    CHECK(client->evaluate("( 2 + 3 ) * 4") == "20");
+    CHECK(client->evaluate("3000000000 * 3") == "9000000000");  // --type=int64
+    CHECK_THROWS_WITH(client->evaluate("1 + 2 + 3 + 4 + 5 + 6"), "token limit exceeded");
+    CHECK_THROWS_WITH(client->evaluate("2 + x"), "Invalid character was found.");
+    CHECK_THROWS_WITH(client->evaluate("7 % 0"), "division by zero");
+    CHECK(client->evaluate("-9 / 2") == "-4");
+
+    // Two clients at once, the server has two channels
+    {
+        ShmClient second(name);
+        CHECK(second.evaluate("1 + 1") == "2");
+        CHECK_THROWS_AS(ShmClient(name), std::runtime_error);
+    }
+
+    client.reset();
+    ::kill(server, SIGTERM);
+    int status = 0;
+    REQUIRE(::waitpid(server, &status, 0) == server);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    CHECK_THROWS_AS(ShmClient(name), std::system_error);  // the region is removed
+}
+
+// Test what dead processes leave behind
+TEST_CASE("stale channels and regions", "[shm]") {
+    std::string name = region_name("stale");
+
+    SECTION("a channel whose client died is taken over") {
+        ShmServer server(name, 1, evaluate_infix);
+
+        // The child claims the only channel, leaves requests and dies
+        pid_t child = ::fork();
+        REQUIRE(child >= 0);
+        if (child == 0) {
+            ShmClient* client = new ShmClient(name);  // never released
+            client->submit("1 + 1");
+            client->submit("2 + 2");
+            ::_exit(0);
+        }
+        int status = 0;
+        REQUIRE(::waitpid(child, &status, 0) == child);
+        REQUIRE(WIFEXITED(status));
+
+        ShmClient client(name);
+        CHECK(client.pending() == 0);  // the results of the dead client are dropped
+        CHECK(client.evaluate("3 + 3") == "6");
+        CHECK_THROWS_AS(ShmClient(name), std::runtime_error);  // a live owner keeps it
+    }
+
+    SECTION("a region whose server died is replaced") {
+        pid_t child = ::fork();
+        REQUIRE(child >= 0);
+        if (child == 0) {
+            new ShmServer(name, 1, evaluate_infix);  // never removed
+            ::_exit(0);
+        }
+        int status = 0;
+        REQUIRE(::waitpid(child, &status, 0) == child);
+        REQUIRE(WIFEXITED(status));
+
+        CHECK_THROWS_AS(ShmClient(name), std::runtime_error);  // marked running, but dead
+        ShmServer server(name, 1, evaluate_infix);
+        ShmClient client(name);
+        CHECK(client.evaluate("4 * 4") == "16");
+    }
+}
+
+/* EOF */
@@ -0,0 +1,438 @@
+/// @file shm_ring.cpp
+/// @author Etienne Bravo
+///
+/// @brief Shared memory setup, futex waits and the ring protocol of the
+/// ShmServer and ShmClient classes.
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "shm_ring.hpp"
+
+namespace {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) &&
+              std::atomic<std::uint32_t>::is_always_lock_free,
+              "futexes need plain 32-bit atomics");
+
+/// Polls made before a side goes to sleep. The first ones only pause the
+/// core, a few microseconds in all. The others yield the core, which lets
+/// the other side run when both share a core. With a single CPU pausing
+/// only delays the other side, so only yields are made.
+const unsigned yield_limit = 100;
+
+unsigned spin_limit()
+{
+    static const unsigned limit = std::thread::hardware_concurrency() > 1 ? 1000 : 0;
+    return limit;
+}
+
+/// Longest futex sleep, after which a sleeper checks the other side is alive.
+const long sleep_ns = 100 * 1000 * 1000;
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// The futex word is shared between processes, so the PRIVATE variants
+// cannot be used.
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected)
+{
+    struct timespec timeout = {0, sleep_ns};
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected,
+              &timeout, nullptr, 0);
+}
+
+void futex_wake(std::atomic<std::uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX,
+              nullptr, nullptr, 0);
+}
+
+/// Advances a counter and wakes the other side if it sleeps on it. The store
+/// and the load of the flag are sequentially consistent, paired with the
+/// ones of wait_change(), so one side always sees the other.
+void publish(std::atomic<std::uint32_t>& counter, std::uint32_t value,
+             std::atomic<std::uint32_t>& waiting)
+{
+    counter.store(value);
+    if (waiting.load() != 0)
+    {
+        futex_wake(counter);
+    }
+}
+
+/// Waits until counter differs from seen, spinning first and then sleeping
+/// on the futex of the counter with the waiting flag set.
+/// @param keep_waiting Checked between sleeps, waiting ends when it is false.
+/// @return The new value of counter, or seen if waiting ended.
+template <class Keep>
+std::uint32_t wait_change(std::atomic<std::uint32_t>& counter, std::uint32_t seen,
+                          std::atomic<std::uint32_t>& waiting, Keep keep_waiting)
+{
+    unsigned pauses = spin_limit();
+    for (unsigned spin = 0; spin < pauses + yield_limit; ++spin)
+    {
+        std::uint32_t now = counter.load(std::memory_order_acquire);
+        if (now != seen)
+        {
+            return now;
+        }
+        if (spin < pauses)
+        {
+            cpu_relax();
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    for (;;)
+    {
+        waiting.store(1);
+        if (counter.load() == seen && keep_waiting())
+        {
+            futex_wait(counter, seen);
+        }
+        waiting.store(0);
+
+        std::uint32_t now = counter.load(std::memory_order_acquire);
+        if (now != seen || !keep_waiting())
+        {
+            return now;
+        }
+    }
+}
+
+/// @return True if a process with the given pid exists.
+bool alive(std::uint32_t pid)
+{
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+}
+
+/// Bytes before the first channel.
+constexpr std::size_t header_bytes =
+    (sizeof(shm::Header) + alignof(shm::Channel) - 1) / alignof(shm::Channel) * alignof(shm::Channel);
+
+/// Maps an open region.
+/// @throws std::system_error if mmap() fails.
+shm::Header* map_region(int fd, std::size_t size)
+{
+    void* region = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    ::close(fd);
+    return static_cast<shm::Header*>(region);
+}
+
+} // namespace
+
+namespace shm {
+
+std::size_t region_size(std::uint32_t channels)
+{
+    return header_bytes + channels * sizeof(Channel);
+}
+
+Channel& channel(Header* header, std::uint32_t i)
+{
+    return reinterpret_cast<Channel*>(reinterpret_cast<char*>(header) + header_bytes)[i];
+}
+
+} // namespace shm
+
+///----------------------------------------------------------------------------
+///                              SHM SERVER
+///----------------------------------------------------------------------------
+
+ShmServer::ShmServer(const std::string& name, unsigned channels, Handler handler)
+: name(name), handler(std::move(handler)), header(nullptr),
+  size(shm::region_size(std::max(channels, 1u)))
+{
+    channels = std::max(channels, 1u);
+
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    // A region left by a server that was killed is replaced
+    if (fd < 0 && errno == EEXIST)
+    {
+        int old = ::shm_open(name.c_str(), O_RDONLY, 0);
+        struct stat info;
+        if (old >= 0 && ::fstat(old, &info) == 0 &&
+            static_cast<std::size_t>(info.st_size) >= sizeof(shm::Header))
+        {
+            void* region = ::mmap(nullptr, sizeof(shm::Header), PROT_READ, MAP_SHARED, old, 0);
+            if (region != MAP_FAILED)
+            {
+                std::uint32_t pid = static_cast<shm::Header*>(region)->pid;
+                if (pid == 0 || !alive(pid))
+                {
+                    ::shm_unlink(name.c_str());
+                }
+                ::munmap(region, sizeof(shm::Header));
+            }
+        }
+        if (old >= 0)
+        {
+            ::close(old);
+        }
+        fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+    }
+
+    try
+    {
+        header = map_region(fd, size);
+    }
+    catch (...)
+    {
+        ::shm_unlink(name.c_str());
+        throw;
+    }
+
+    // The region is zero filled, the objects only need to be started
+    new (header) shm::Header();
+    header->version = shm::version;
+    header->channels = channels;
+    header->pid = static_cast<std::uint32_t>(::getpid());
+    header->running.store(1);
+    for (std::uint32_t i = 0; i < channels; ++i)
+    {
+        new (&shm::channel(header, i)) shm::Channel();
+    }
+    header->magic.store(shm::magic, std::memory_order_release);
+
+    for (std::uint32_t i = 0; i < channels; ++i)
+    {
+        workers.emplace_back(&ShmServer::serve, this, std::ref(shm::channel(header, i)));
+    }
+}
+
+ShmServer::~ShmServer()
+{
+    stop();
+    ::munmap(header, size);
+    ::shm_unlink(name.c_str());
+}
+
+void ShmServer::stop()
+{
+    if (workers.empty())
+    {
+        return;
+    }
+
+    header->running.store(0);
+    for (std::uint32_t i = 0; i < header->channels; ++i)
+    {
+        futex_wake(shm::channel(header, i).submitted);
+        futex_wake(shm::channel(header, i).completed);
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ShmServer::serve(shm::Channel& channel)
+{
+    auto running = [this] { return header->running.load(std::memory_order_acquire) != 0; };
+    std::uint32_t completed = channel.completed.load(std::memory_order_relaxed);
+    std::string expression;
+    std::string result;
+
+    while (running())
+    {
+        std::uint32_t submitted = channel.submitted.load(std::memory_order_acquire);
+        if (submitted == completed)
+        {
+            wait_change(channel.submitted, completed, channel.server_waiting, running);
+            continue;
+        }
+
+        // The result overwrites the expression in the same slot
+        for (; completed != submitted; ++completed)
+        {
+            shm::Slot& slot = channel.slots[completed % shm::ring_slots];
+            expression.assign(slot.text, std::min<std::size_t>(slot.length, sizeof(slot.text)));
+
+            bool ok;
+            try
+            {
+                ok = handler(expression, result);
+            }
+            catch (const std::exception& e)
+            {
+                ok = false;
+                result = e.what();
+            }
+
+            std::size_t length = std::min(result.size(), sizeof(slot.text));
+            std::memcpy(slot.text, result.data(), length);
+            slot.length = static_cast<std::uint32_t>(length);
+            slot.status = ok ? shm::OK : shm::ERROR;
+
+            publish(channel.completed, completed + 1, channel.client_waiting);
+        }
+    }
+}
+
+///----------------------------------------------------------------------------
+///                              SHM CLIENT
+///----------------------------------------------------------------------------
+
+ShmClient::ShmClient(const std::string& name)
+: header(nullptr), channel(nullptr), size(0)
+{
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(shm::Header))
+    {
+        ::close(fd);
+        throw std::runtime_error(name + " is not a postfix_calc server");
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    header = map_region(fd, size);
+
+    if (header->magic.load(std::memory_order_acquire) != shm::magic ||
+        header->version != shm::version || size < shm::region_size(header->channels) ||
+        header->running.load() == 0 || !alive(header->pid))
+    {
+        ::munmap(header, size);
+        throw std::runtime_error(name + " is not a running postfix_calc server");
+    }
+
+    // Claim a free channel, or one whose client exited without releasing it
+    std::uint32_t pid = static_cast<std::uint32_t>(::getpid());
+    for (std::uint32_t i = 0; i < header->channels && channel == nullptr; ++i)
+    {
+        shm::Channel& candidate = shm::channel(header, i);
+        std::uint32_t owner = 0;
+        if (candidate.owner.compare_exchange_strong(owner, pid) ||
+            (!alive(owner) && candidate.owner.compare_exchange_strong(owner, pid)))
+        {
+            channel = &candidate;
+        }
+    }
+
+    if (channel == nullptr)
+    {
+        ::munmap(header, size);
+        throw std::runtime_error("every channel of " + name + " is in use");
+    }
+
+    // Requests left by a previous client are served, then their results dropped
+    std::uint32_t submitted = channel->submitted.load();
+    std::uint32_t completed = channel->completed.load(std::memory_order_acquire);
+    auto running = [this] { return header->running.load() != 0 && alive(header->pid); };
+    while (completed != submitted && running())
+    {
+        completed = wait_change(channel->completed, completed, channel->client_waiting, running);
+    }
+    channel->collected = completed;
+}
+
+ShmClient::~ShmClient()
+{
+    channel->owner.store(0, std::memory_order_release);
+    ::munmap(header, size);
+}
+
+void ShmClient::submit(const std::string& expression)
+{
+    if (expression.size() > sizeof(shm::Slot::text))
+    {
+        throw std::length_error("expression does not fit in a slot");
+    }
+
+    std::uint32_t submitted = channel->submitted.load(std::memory_order_relaxed);
+    if (submitted - channel->collected == shm::ring_slots)
+    {
+        throw std::out_of_range("request ring is full");
+    }
+
+    shm::Slot& slot = channel->slots[submitted % shm::ring_slots];
+    std::memcpy(slot.text, expression.data(), expression.size());
+    slot.length = static_cast<std::uint32_t>(expression.size());
+
+    publish(channel->submitted, submitted + 1, channel->server_waiting);
+}
+
+bool ShmClient::receive(std::string& result)
+{
+    std::uint32_t collected = channel->collected;
+    if (collected == channel->submitted.load(std::memory_order_relaxed))
+    {
+        throw std::out_of_range("no request is pending");
+    }
+
+    std::uint32_t completed = channel->completed.load(std::memory_order_acquire);
+    if (completed == collected)
+    {
+        auto running = [this] { return header->running.load() != 0 && alive(header->pid); };
+        completed = wait_change(channel->completed, collected, channel->client_waiting, running);
+        if (completed == collected)
+        {
+            throw std::runtime_error("the server stopped");
+        }
+    }
+
+    const shm::Slot& slot = channel->slots[collected % shm::ring_slots];
+    result.assign(slot.text, slot.length);
+    channel->collected = collected + 1;
+    return slot.status == shm::OK;
+}
+
+std::string ShmClient::evaluate(const std::string& expression)
+{
+    std::string result;
+    submit(expression);
+    if (!receive(result))
+    {
+        throw std::runtime_error(result);
+    }
+    return result;
+}
+
+std::size_t ShmClient::pending() const
+{
+    return channel->submitted.load(std::memory_order_relaxed) - channel->collected;
+}
@@ -0,0 +1,189 @@
+/// @file shm_ring.hpp
+/// @author Etienne Bravo
+///
+/// @brief Evaluation service for processes on the same host, over rings of
+/// slots in POSIX shared memory.
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace shm {
+
+constexpr std::uint32_t magic      = 0x50464352;  ///< "PFCR", marks a ready region
+constexpr std::uint32_t version    = 1;           ///< layout version
+constexpr std::size_t   slot_size  = 256;         ///< bytes per slot
+constexpr std::size_t   ring_slots = 64;          ///< slots per channel, a power of two
+
+/// Status of a completed slot.
+enum Status : std::int32_t {
+    OK    = 0,  ///< text holds the result
+    ERROR = 1,  ///< text holds an error message
+};
+
+/// A slot holds an expression written by the client, then the result or
+/// error message written back in place by the server.
+struct Slot {
+    std::uint32_t length;                          ///< bytes used in text
+    std::int32_t  status;                          ///< Status of the result
+    char          text[slot_size - 2 * sizeof(std::uint32_t)];
+};
+
+/// @brief A single-producer/single-consumer pair of rings between one client
+/// and one server worker.
+///
+/// The slots form a ring walked by three counters. The request ring is the
+/// slots in [completed, submitted), written by the client and read by the
+/// server. The response ring is the slots in [collected, completed), which
+/// the server has rewritten with their results. Counters only grow and are
+/// reduced modulo ring_slots, so each one has a single writer and needs no
+/// lock. Counters are on their own cache lines so the two sides do not
+/// invalidate each other's lines on every update.
+///
+/// A side that finds nothing to do spins for a while, then sets its waiting
+/// flag and sleeps on a futex over the counter the other side advances. The
+/// other side issues a futex wake only when that flag is set.
+struct Channel {
+    alignas(64) std::atomic<std::uint32_t> submitted;       ///< written by the client
+    alignas(64) std::atomic<std::uint32_t> completed;       ///< written by the server
+    alignas(64) std::uint32_t              collected;       ///< client only
+    std::atomic<std::uint32_t>             owner;           ///< pid of the client, 0 if free
+    alignas(64) std::atomic<std::uint32_t> server_waiting;  ///< server sleeps on submitted
+    alignas(64) std::atomic<std::uint32_t> client_waiting;  ///< client sleeps on completed
+    alignas(64) Slot                       slots[ring_slots];
+};
+
+/// Start of the shared memory region, followed by the channels.
+struct Header {
+    std::atomic<std::uint32_t> magic;     ///< shm::magic once the server is ready
+    std::uint32_t              version;   ///< shm::version
+    std::uint32_t              channels;  ///< number of channels
+    std::uint32_t              pid;       ///< pid of the server
+    std::atomic<std::uint32_t> running;   ///< cleared when the server stops
+};
+
+/// @return Size of a region with the given number of channels.
+std::size_t region_size(std::uint32_t channels);
+
+/// @return Channel i of a region.
+Channel& channel(Header* header, std::uint32_t i);
+
+} // namespace shm
+
+/// @brief Serves a shared memory region, one worker thread per channel.
+///
+/// The region is created with shm_open() under the given name and removed
+/// by the destructor. Each worker polls its channel, gives every expression
+/// to the handler and writes the result back into the slot of the request.
+///
+/// Example Usage:
+/// @code
+///   ShmServer server("/postfix_calc", 4, [](const std::string& expression, std::string& result) {
+///       result = std::to_string(eval_infix(expression));
+///       return true;
+///   });
+///   ...
+///   server.stop();
+/// @endcode
+
+class ShmServer {
+public:
+    /// Evaluates an expression. Returns false if it failed, with the error
+    /// message in result. Called by the workers at the same time.
+    using Handler = std::function<bool(const std::string& expression, std::string& result)>;
+
+    /// Creates the region and starts the workers.
+    /// @throws std::system_error if the region cannot be created.
+    /// @param name Name of the region, starting with '/'.
+    /// @param channels Number of clients that can be connected at once.
+    /// @param handler Evaluates the expressions.
+    ShmServer(const std::string& name, unsigned channels, Handler handler);
+
+    /// Stops the workers and removes the region.
+    ~ShmServer();
+
+    ShmServer(const ShmServer&) = delete;
+    ShmServer& operator=(const ShmServer&) = delete;
+
+    /// Stops the workers. Connected clients see the server stop.
+    void stop();
+
+private:
+    /// Serves one channel until stop() is called.
+    void serve(shm::Channel& channel);
+
+    std::string              name;
+    Handler                  handler;
+    shm::Header*             header;
+    std::size_t              size;     ///< bytes mapped
+    std::vector<std::thread> workers;
+};
+
+/// @brief Client side of a ShmServer.
+///
+/// A client claims a free channel of the region on construction and gives
+/// it back on destruction. Requests can be pipelined: up to capacity()
+/// expressions may be submitted before their results are received, and
+/// results come back in submission order.
+///
+/// Example Usage:
+/// @code
+///   ShmClient client("/postfix_calc");
+///   std::cout << client.evaluate("2 + 3 * 4") << std::endl; // Outputs: 14
+/// @endcode
+
+class ShmClient {
+public:
+    /// Opens the region and claims a channel.
+    /// @throws std::system_error if the region cannot be opened.
+    /// @throws std::runtime_error if it is not the region of a running
+    /// server or every channel is in use.
+    /// @param name Name given to the server.
+    explicit ShmClient(const std::string& name);
+
+    /// Releases the channel and unmaps the region.
+    ~ShmClient();
+
+    ShmClient(const ShmClient&) = delete;
+    ShmClient& operator=(const ShmClient&) = delete;
+
+    /// Queues an expression.
+    /// @throws std::length_error if the expression does not fit in a slot.
+    /// @throws std::out_of_range if capacity() requests are already pending.
+    /// @param expression Infix expression.
+    void submit(const std::string& expression);
+
+    /// Waits for the result of the oldest pending request.
+    /// @throws std::out_of_range if no request is pending.
+    /// @throws std::runtime_error if the server stops.
+    /// @param result Receives the result, or the error message.
+    /// @return False if the expression could not be evaluated.
+    bool receive(std::string& result);
+
+    /// Submits an expression and waits for its result.
+    /// @throws std::runtime_error if the expression cannot be evaluated, with
+    /// the error message of the server.
+    /// @param expression Infix expression.
+    /// @return The result as printed by the calculator.
+    std::string evaluate(const std::string& expression);
+
+    /// @return Number of submitted requests whose results were not received.
+    std::size_t pending() const;
+
+    /// @return Largest number of pending requests.
+    static constexpr std::size_t capacity() { return shm::ring_slots; }
+
+private:
+    shm::Header*  header;
+    shm::Channel* channel;
+    std::size_t   size;     ///< bytes mapped
+};
+
+#endif // SHM_RING_HPP
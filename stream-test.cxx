@@ -0,0 +1,142 @@
+/// @file stream-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the StreamEvaluator class of libpostfix: the same
+/// values as eval_infix() whatever the size of the chunks, with numbers,
+/// signs and line endings cut between two chunks. Build with
+///
+///   make lib && g++ -std=gnu++20 stream-test.cxx libpostfix.a -pthread -lrt
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "postfix.hpp"
+#include "stream_eval.hpp"  // check include guard
+
+// Feeds text in chunks of the given size
+template <class Num>
+Num feed_chunks(StreamEvaluator<Num>& engine, const std::string& text, std::size_t chunk) {
+    for (std::size_t start = 0; start < text.size(); start += chunk) {
+        engine.feed(text.data() + start, std::min(chunk, text.size() - start));
+    }
+    return engine.finish();
+}
+
+// Products of numbers of one to six digits, summed
+std::string random_expression(std::mt19937& random, std::size_t terms) {
+    std::uniform_int_distribution<std::int64_t> literal(-999999, 999999);
+    std::string infix = "( 0";
+    for (std::size_t i = 0; i < terms; ++i) {
+        infix += random() % 2 ? " + " : " - ";
+        infix += "( " + std::to_string(literal(random) >> (random() % 20)) + " * ";
+        infix += std::to_string(literal(random) >> (random() % 20)) + " )";
+    }
+    return infix + " ) % 1000000007";
+}
+
+// Test chunks of every size
+TEST_CASE("chunks", "[stream]") {
+    StreamEvaluator<std::int64_t> engine;
+    std::mt19937 random(26);
+    const std::size_t chunks[] = {1, 2, 7, 4096};
+
+    SECTION("random expressions") {
+        for (std::size_t terms : {0, 1, 5, 100, 2000}) {
+            std::string infix = random_expression(random, terms);
+            std::int64_t expected = eval_infix<std::int64_t>(infix);
+            for (std::size_t chunk : chunks) {
+                INFO(terms << " terms, chunks of " << chunk);
+                CHECK(feed_chunks(engine, infix, chunk) == expected);
+            }
+        }
+    }
+
+    SECTION("a number cut at every position") {
+        std::string infix = "12345678 - -9876543 * 2";
+        for (std::size_t cut = 0; cut <= infix.size(); ++cut) {
+            INFO("cut at " << cut);
+            engine.feed(infix.data(), cut);
+            engine.feed(infix.data() + cut, infix.size() - cut);
+            CHECK(engine.finish() == 12345678 - -9876543LL * 2);
+        }
+    }
+
+    SECTION("a sign and a subtraction cut after the '-'") {
+        engine.feed("10 -", 4);
+        engine.feed("3", 1);
+        CHECK_THROWS_AS(engine.finish(), std::invalid_argument);  // two numbers
+        CHECK_THROWS_AS(eval_infix<std::int64_t>("10 -3"), std::invalid_argument);
+
+        engine.feed("10 -", 4);
+        engine.feed(" 3", 2);
+        CHECK(engine.finish() == 7);
+    }
+
+    SECTION("malformed expressions, and the next one after them") {
+        for (const char* infix : {"1 2", "1 +", "( 1 + 2", "1 + 2 )", ") 1 (", "( )"}) {
+            INFO(infix);
+            try {
+                engine.feed(infix, std::string(infix).size());
+                CHECK_THROWS_AS(engine.finish(), std::invalid_argument);
+            } catch (const std::invalid_argument&) {
+                engine.reset();  // found while feeding
+            }
+            engine.feed("( 2 + 3 ) * 4", 13);
+            CHECK(engine.finish() == 20);
+        }
+    }
+
+    SECTION("line endings cut between the \\r and the \\n") {
+        std::string infix = "( 1 + 22 ) * 333\r\n";
+        for (std::size_t chunk : chunks) {
+            INFO("chunks of " << chunk);
+            CHECK(feed_chunks(engine, infix, chunk) == 7659);
+        }
+        engine.feed("4 * 5\r", 6);
+        engine.feed("\n", 1);
+        CHECK(engine.finish() == 20);
+    }
+}
+
+// Test lines longer than the chunks of read_line()
+TEST_CASE("read_line", "[stream]") {
+    StreamEvaluator<std::int64_t> engine;
+    const std::size_t chunk = StreamEvaluator<std::int64_t>::chunk_size - 1;  // getline keeps a byte for '\0'
+
+    // A number across the end of the first chunk
+    std::string across = "1";
+    while (across.size() < chunk - 10) {
+        across += " + 1";
+    }
+    across.resize(chunk - 6, ' ');
+    across += " + 123456789";
+    REQUIRE(across.find("123456789") == chunk - 3);
+
+    // A line that fills a chunk exactly, its '\r' is the last byte
+    std::string full = "2";
+    while (full.size() < chunk - 5) {
+        full += " * 1";
+    }
+    full.resize(chunk - 1, ' ');
+    full += '\r';
+    REQUIRE(full.size() == chunk);
+
+    std::istringstream in(across + "\r\n" + full + "\n" + "7 - 2\r\n" + "3 * 4");
+    std::vector<std::int64_t> values;
+    std::int64_t value;
+    while (engine.read_line(in, value)) {
+        values.push_back(value);
+    }
+
+    std::vector<std::int64_t> expected{eval_infix<std::int64_t>(across), 2, 5, 12};
+    CHECK(values == expected);
+}
+
+/* EOF */
@@ -0,0 +1,166 @@
+/// @file stream_eval.cpp
+/// @author Etienne Bravo
+///
+/// @brief Implementation of the StreamEvaluator class.
+
+#include <cctype>
+#include <stdexcept>
+#include "alloc_track.hpp"
+#include "calculator.hpp"
+#include "numeric.hpp"
+#include "stream_eval.hpp"
+
+template <class Num>
+StreamEvaluator<Num>::StreamEvaluator() : pending_minus(false)
+{
+    reducer.reserve(Calculator<Num>::default_depth);
+}
+
+template <class Num>
+void StreamEvaluator<Num>::feed(const char* data, std::size_t length)
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        char token = data[i];
+        bool digit = std::isdigit(static_cast<unsigned char>(token));
+
+        // The '-' seen last is a sign only if this character is a digit
+        if (pending_minus)
+        {
+            pending_minus = false;
+            if (digit)
+            {
+                literal += '-';
+            }
+            else
+            {
+                grammar.symbol('-');
+                reducer.push_operator('-');
+            }
+        }
+
+        // Numbers and negative numbers
+        if (digit)
+        {
+            if (literal.size() == max_literal)
+            {
+                throw std::out_of_range("number out of range");
+            }
+            literal += token;
+            continue;
+        }
+
+        if (!literal.empty())
+        {
+            end_number();
+        }
+
+        if (std::isspace(static_cast<unsigned char>(token)))
+        {
+            continue;
+        }
+
+        if (token == '-')
+        {
+            pending_minus = true;
+        }
+        else
+        {
+            grammar.symbol(token);
+            reducer.push_operator(token);
+        }
+    }
+}
+
+template <class Num>
+Num StreamEvaluator<Num>::finish()
+{
+    alloc_track::PhaseScope phase(alloc_track::EVALUATE);
+    Num result;
+    try
+    {
+        if (pending_minus)
+        {
+            pending_minus = false;
+            grammar.symbol('-');
+            reducer.push_operator('-');
+        }
+        if (!literal.empty())
+        {
+            end_number();
+        }
+
+        // Values left over and unmatched parentheses
+        grammar.finish();
+        result = reducer.finish();
+    }
+    catch (...)
+    {
+        reset();
+        throw;
+    }
+    reset();
+    return result;
+}
+
+template <class Num>
+bool StreamEvaluator<Num>::read_line(std::istream& in, Num& result)
+{
+    bool got_line = false;
+
+    reset();
+    buffer.resize(chunk_size);
+    for (;;)
+    {
+        in.getline(&buffer[0], chunk_size);
+        std::streamsize extracted = in.gcount();
+
+        // The buffer filled up before the end of the line
+        if (in.fail() && !in.eof() && !in.bad())
+        {
+            feed(buffer.data(), extracted);
+            got_line = true;
+            in.clear();
+            continue;
+        }
+
+        // Last chunk, the delimiter is counted but not stored
+        if (!in.fail())
+        {
+            feed(buffer.data(), in.eof() ? extracted : extracted - 1);
+            got_line = true;
+        }
+        break;
+    }
+
+    if (got_line)
+    {
+        result = finish();
+    }
+    return got_line;
+}
+
+template <class Num>
+void StreamEvaluator<Num>::reset()
+{
+    reducer.reset();
+    grammar.reset();
+    literal.clear();
+    pending_minus = false;
+}
+
+template <class Num>
+void StreamEvaluator<Num>::end_number()
+{
+    grammar.value();
+    reducer.push_value(Numeric<Num>::parse(literal.data(), literal.data() + literal.size()));
+    literal.clear();
+}
+
+// Evaluators for the supported numeric types
+template class StreamEvaluator<int>;
+template class StreamEvaluator<std::int64_t>;
+template class StreamEvaluator<__int128>;
+template class StreamEvaluator<double>;
+template class StreamEvaluator<Decimal>;
@@ -0,0 +1,87 @@
+/// @file stream_eval.hpp
+/// @author Etienne Bravo
+///
+/// @brief Streaming evaluator for Infix expressions that are too large to be
+/// held in memory as a single string.
+
+#ifndef STREAM_EVAL_HPP
+#define STREAM_EVAL_HPP
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include "infix_reducer.hpp"
+
+/// @brief Evaluates an Infix expression that is fed to it in chunks.
+///
+/// infix2postfix() needs the whole expression in one string and builds the
+/// whole Postfix expression in another before eval_postfix() starts. This
+/// class never stores the expression: characters are consumed as they
+/// arrive and every operator is applied to the value stack as soon as the
+/// shunting-yard rules allow it. Memory use is bounded by the nesting depth
+/// of the expression, not by its length.
+///
+/// Numbers and signs may be split across chunk boundaries. The input rules
+/// are the same as for infix2postfix(): a '-' directly followed by a digit is
+/// the sign of a number, otherwise it is the subtraction operator.
+///
+/// Like eval_postfix(), the evaluator is a template over the numeric type and
+/// is instantiated for every type that has a Numeric specialization.
+///
+/// @tparam Num Numeric type used for operands and results.
+///
+/// Example Usage:
+/// @code
+///   StreamEvaluator<int> engine;
+///   engine.feed("( 4000 + 30", 11);
+///   engine.feed("00 ) * 1000", 11);
+///   std::cout << engine.finish() << std::endl; // Outputs: 7000000
+/// @endcode
+
+template <class Num = int>
+class StreamEvaluator {
+public:
+    /// Size of the chunks read by read_line().
+    static constexpr std::size_t chunk_size = 64 * 1024;
+
+    /// Longest accepted number literal, keeps memory bounded on bad input.
+    static constexpr std::size_t max_literal = 64;
+
+    /// Default constructor.
+    StreamEvaluator();
+
+    /// Consumes the next chunk of the expression.
+    /// @param data Pointer to the first character of the chunk.
+    /// @param length Number of characters in the chunk.
+    /// @throws std::invalid_argument if a token is out of place, reset()
+    /// then discards the expression.
+    void feed(const char* data, std::size_t length);
+
+    /// Ends the expression, applies the remaining operators and resets the
+    /// evaluator so it can be fed the next expression, also when it throws.
+    /// @return Num The value of the expression.
+    /// @throws std::invalid_argument if an operand is missing or left over,
+    /// or a parenthesis is unbalanced.
+    Num finish();
+
+    /// Evaluates the next line of a stream, reading it chunk by chunk.
+    /// @param in Stream to read from.
+    /// @param result Receives the value of the line.
+    /// @return True if a line was read, false at end of input.
+    bool read_line(std::istream& in, Num& result);
+
+    /// Discards any partially fed expression.
+    void reset();
+
+private:
+    /// Pushes the number being read onto the value stack.
+    void end_number();
+
+    InfixReducer<Num> reducer;        ///< operator and value stacks
+    InfixGrammar      grammar;        ///< order of the tokens
+    std::string       literal;        ///< number being read, may span chunks
+    bool              pending_minus;  ///< last character was a '-'
+    std::string       buffer;         ///< chunk buffer used by read_line()
+};
+
+#endif // STREAM_EVAL_HPP
@@ -0,0 +1,209 @@
+/// @file trace-test.cxx
+/// @author Etienne Bravo
+///
+/// @brief Unit tests for the event tracer: the spans of a line and their
+/// arguments, the slow line filter, cancelled lines, buffers handed over
+/// between threads and the Chrome trace event output.
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "trace.hpp"  // check include guard
+
+// Recorded events, in the order each thread recorded them
+std::vector<trace::Event> events() {
+    std::vector<trace::Event> found;
+    for (trace::Buffer* b = trace::buffers_head.load(); b != nullptr; b = b->next) {
+        for (trace::Block* block = b->first; block != nullptr; block = block->next) {
+            found.insert(found.end(), block->events, block->events + block->used);
+            if (block == b->current) {
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+// Number of buffers ever created
+std::size_t buffers() {
+    std::size_t count = 0;
+    for (trace::Buffer* b = trace::buffers_head.load(); b != nullptr; b = b->next) {
+        ++count;
+    }
+    return count;
+}
+
+// Test the spans of a line
+TEST_CASE("spans", "[trace]") {
+    trace::reset();
+
+    SECTION("nothing is recorded while tracing is off") {
+        trace::enable(false);
+        {
+            trace::LineScope line(1, "1 + 2");
+            trace::Span span(trace::EVALUATE);
+        }
+        CHECK(events().empty());
+    }
+
+    SECTION("the probes see the line while tracing is off") {
+        trace::enable(false);
+        {
+            trace::LineScope outer(4);
+            CHECK(trace::current_line.number == 4);
+            {
+                trace::LineScope line(7, "( 1 + 2 )");
+                CHECK(trace::current_line.number == 7);
+                CHECK(trace::current_line.length == 9);
+            }
+            CHECK(trace::current_line.number == 4);
+        }
+        CHECK(trace::current_line.number == 0);
+    }
+
+    SECTION("spans carry the number, length and depth of their line") {
+        trace::enable();
+        {
+            trace::LineScope line(7, "( ( 1 + 2 ) * ( 3 ) )");
+            trace::Span span(trace::EVALUATE);
+        }
+        {
+            trace::Span span(trace::PARSE);
+        }
+
+        std::vector<trace::Event> found = events();
+        REQUIRE(found.size() == 3);
+        CHECK(found[0].phase == trace::EVALUATE);
+        CHECK(found[1].phase == trace::LINE);
+        CHECK(found[0].line == 7);
+        CHECK(found[0].length == 21);
+        CHECK(found[0].depth == 2);
+        CHECK(found[1].begin <= found[0].begin);
+        CHECK(found[1].end >= found[0].end);
+        CHECK(found[2].phase == trace::PARSE);
+        CHECK(found[2].line == 0);
+    }
+
+    SECTION("events fill several blocks") {
+        trace::enable();
+        for (std::size_t i = 0; i < trace::block_events * 2 + 1; ++i) {
+            trace::Span span(trace::WRITE);
+        }
+        CHECK(events().size() == trace::block_events * 2 + 1);
+    }
+
+    trace::enable(false);
+}
+
+// Lines faster than this are dropped, far above a time slice so that a
+// fast line preempted on a loaded machine is still dropped
+const std::uint64_t slow_line_ns = 200000000;
+
+// Test the slow line filter and cancelled lines
+TEST_CASE("dropped lines", "[trace]") {
+    trace::reset();
+
+    SECTION("fast lines and spans outside a line are left out") {
+        trace::enable(true, slow_line_ns);
+        {
+            trace::LineScope line(1, "1");
+            trace::Span span(trace::EVALUATE);
+        }
+        {
+            trace::Span span(trace::WRITE);
+        }
+        {
+            trace::LineScope line(2, "2");
+            trace::Span span(trace::EVALUATE);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(slow_line_ns + 50000000));
+        }
+
+        std::vector<trace::Event> found = events();
+        REQUIRE(found.size() == 2);
+        CHECK(found[0].line == 2);
+        CHECK(found[1].phase == trace::LINE);
+    }
+
+    SECTION("a dropped line across a block boundary") {
+        trace::enable(true, slow_line_ns);
+        {
+            trace::LineScope line(1, "1");
+            for (std::size_t i = 0; i < trace::block_events + 10; ++i) {
+                trace::Span span(trace::PARSE);
+            }
+        }
+        CHECK(events().empty());
+    }
+
+    SECTION("a cancelled line") {
+        trace::enable();
+        {
+            trace::LineScope line(1, "1");
+            trace::Span span(trace::EVALUATE);
+        }
+        {
+            trace::LineScope line(2);
+            {
+                trace::Span span(trace::EVALUATE);
+            }
+            line.cancel();
+        }
+
+        std::vector<trace::Event> found = events();
+        REQUIRE(found.size() == 2);
+        CHECK(found[1].line == 1);
+    }
+
+    trace::enable(false);
+}
+
+// Test the buffers of several threads
+TEST_CASE("threads", "[trace]") {
+    trace::reset();
+    trace::enable();
+
+    auto worker = [] {
+        trace::LineScope line(3, "3");
+        trace::Span span(trace::EVALUATE);
+    };
+
+    std::thread(worker).join();
+    std::size_t created = buffers();
+    std::thread(worker).join();
+
+    CHECK(buffers() == created);
+    CHECK(events().size() == 4);
+
+    trace::enable(false);
+}
+
+// Test the Chrome trace event output
+TEST_CASE("write", "[trace]") {
+    trace::reset();
+    trace::enable();
+    {
+        trace::LineScope line(12, "( 1 )");
+        trace::Span span(trace::CONVERT);
+    }
+    trace::enable(false);
+
+    std::ostringstream out;
+    trace::write(out);
+    std::string json = out.str();
+
+    CHECK(json.rfind("{\"traceEvents\":[\n", 0) == 0);
+    CHECK(json.find("\"name\":\"process_name\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"convert\",\"cat\":\"postfix_calc\",\"ph\":\"X\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"line\"") != std::string::npos);
+    CHECK(json.find("\"args\":{\"line\":12,\"length\":5,\"depth\":1}") != std::string::npos);
+    std::string end = "\n],\"displayTimeUnit\":\"ns\"}\n";
+    CHECK(json.compare(json.size() - end.size(), end.size(), end) == 0);
+}
+
+/* EOF */
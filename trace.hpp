@@ -0,0 +1,363 @@
+/// @file trace.hpp
+/// @author Etienne Bravo
+///
+/// @brief Opt-in event tracer. Records when each input line is parsed,
+/// converted, evaluated and written, and saves the events in the Chrome
+/// trace event format, to be opened in chrome://tracing or Perfetto.
+///
+/// Tracing is off by default and then costs one relaxed atomic load per
+/// span. Once enabled, every span is stored as one event in a buffer owned
+/// by the calling thread, so threads never wait for each other. A buffer is
+/// handed over to a new thread when its thread exits. Each event carries the
+/// number, length and nesting depth of the line being evaluated.
+///
+/// If <sys/sdt.h> is available, the spans are also USDT probes named
+/// postfix_calc:line__begin, line__end, phase__begin and phase__end. They
+/// fire whether tracing is enabled or not and can be attached to with, e.g.,
+/// perf probe -x ./postfix_calc sdt_postfix_calc:phase__begin.
+///
+/// Example Usage:
+/// @code
+///   trace::enable();
+///   {
+///       trace::LineScope line(1, "2 + 3 * 4");
+///       int result = eval_infix("2 + 3 * 4");  // records an "evaluate" span
+///   }
+///   std::ofstream file("trace.json");
+///   trace::write(file);
+/// @endcode
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TRACE_PROBE(name, a, b) DTRACE_PROBE2(postfix_calc, name, a, b)
+#endif
+#endif
+#ifndef TRACE_PROBE
+#define TRACE_PROBE(name, a, b) ((void) 0)
+#endif
+
+namespace trace {
+
+/// Kinds of spans.
+enum Phase {
+    LINE,      ///< a whole input line
+    PARSE,     ///< classify(), character classification and validation
+    CONVERT,   ///< infix2postfix(), not the single pass evaluators
+    EVALUATE,  ///< eval_postfix() and the other evaluators, eval_infix() included
+    WRITE,     ///< writing the result
+    PHASES     ///< number of phases
+};
+
+/// Names of the phases in the trace file.
+inline const char* const phase_names[PHASES] = {"line", "parse", "convert", "evaluate", "write"};
+
+/// A finished span.
+struct Event {
+    std::uint64_t begin;   ///< nanoseconds since the program started
+    std::uint64_t end;     ///< nanoseconds since the program started
+    std::uint64_t line;    ///< number of the line, 0 outside a line
+    std::uint64_t length;  ///< length of the line in bytes
+    std::uint32_t depth;   ///< deepest parenthesis nesting of the line
+    std::uint32_t tid;     ///< thread that recorded the event
+    Phase         phase;
+};
+
+/// Number of events of a Block.
+const std::size_t block_events = 4096;
+
+/// Events are stored in blocks, a full buffer is never copied.
+struct Block {
+    Event        events[block_events];
+    std::size_t  used = 0;
+    Block*       next = nullptr;
+};
+
+/// Events of one thread at a time, kept in a list to be written.
+struct Buffer {
+    Block*            first   = nullptr;
+    Block*            current = nullptr;  ///< last block in use, later blocks are spare
+    std::atomic<bool> owned{true};        ///< a live thread records into the buffer
+    Buffer*           next    = nullptr;
+};
+
+/// Line being evaluated by a thread.
+struct Line {
+    std::uint64_t number = 0;
+    std::uint64_t length = 0;
+    std::uint32_t depth  = 0;
+};
+
+/// Position in a Buffer, see LineScope.
+struct Mark {
+    Block*      block;
+    std::size_t used;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+inline std::atomic<bool>          tracing{false};
+inline std::atomic<std::uint64_t> min_line_ns{0};
+inline std::atomic<Buffer*>       buffers_head{nullptr};
+inline const clock_type::time_point origin = clock_type::now();
+inline thread_local Line          current_line;
+
+/// @return A free buffer, or a new one if every buffer is owned.
+inline Buffer* acquire() {
+    for (Buffer* b = buffers_head.load(std::memory_order_acquire); b != nullptr; b = b->next) {
+        bool owned = false;
+        if (b->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+            return b;
+        }
+    }
+
+    Buffer* created = new Buffer;
+    created->next = buffers_head.load(std::memory_order_relaxed);
+    while (!buffers_head.compare_exchange_weak(created->next, created, std::memory_order_release)) {
+    }
+    return created;
+}
+
+/// Buffer of the calling thread, released when the thread exits.
+class Owner {
+public:
+    ~Owner() {
+        if (buffer != nullptr) {
+            buffer->owned.store(false, std::memory_order_release);
+        }
+    }
+
+    Buffer& get() {
+        if (buffer == nullptr) {
+            buffer = acquire();
+            tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+        }
+        return *buffer;
+    }
+
+    std::uint32_t tid = 0;
+
+private:
+    Buffer* buffer = nullptr;
+};
+
+inline thread_local Owner owner;
+
+/// Starts or stops tracing.
+/// @param on True to start.
+/// @param min_line Lines that take less time, in nanoseconds, are left out
+/// of the trace along with their spans. Spans outside a line are then left
+/// out too.
+inline void enable(bool on = true, std::uint64_t min_line = 0) {
+    min_line_ns.store(min_line, std::memory_order_relaxed);
+    tracing.store(on, std::memory_order_relaxed);
+}
+
+/// @return True if spans are being recorded.
+inline bool active() { return tracing.load(std::memory_order_relaxed); }
+
+/// @return Nanoseconds since the program started.
+inline std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - origin).count();
+}
+
+/// @return The deepest parenthesis nesting of text.
+inline std::uint32_t max_depth(const std::string& text) {
+    long depth = 0;
+    long deepest = 0;
+    for (char c : text) {
+        depth += (c == '(') - (c == ')');
+        deepest = depth > deepest ? depth : deepest;
+    }
+    return static_cast<std::uint32_t>(deepest);
+}
+
+/// Appends a span of the current line to the buffer of the calling thread.
+inline void record(Phase phase, std::uint64_t begin, std::uint64_t end) {
+    Buffer& buffer = owner.get();
+    Block* block = buffer.current;
+
+    if (block == nullptr || block->used == block_events) {
+        Block* next = block != nullptr ? block->next : buffer.first;
+        if (next == nullptr) {
+            next = new Block;
+            (block != nullptr ? block->next : buffer.first) = next;
+        }
+        next->used = 0;
+        buffer.current = block = next;
+    }
+
+    block->events[block->used++] = Event{begin, end, current_line.number, current_line.length,
+                                         current_line.depth, owner.tid, phase};
+}
+
+/// @return The end of the events of the calling thread.
+inline Mark mark() {
+    Buffer& buffer = owner.get();
+    return Mark{buffer.current, buffer.current != nullptr ? buffer.current->used : 0};
+}
+
+/// Drops the events recorded by the calling thread since mark.
+inline void rollback(const Mark& mark) {
+    Buffer& buffer = owner.get();
+    buffer.current = mark.block;
+    if (mark.block != nullptr) {
+        mark.block->used = mark.used;
+    } else if (buffer.first != nullptr) {
+        buffer.current = buffer.first;
+        buffer.first->used = 0;
+    }
+}
+
+/// Records a span of the calling thread for the lifetime of the object.
+class Span {
+public:
+    explicit Span(Phase phase) : phase(phase), on(active()) {
+        if (on) {
+            on = current_line.number != 0 || min_line_ns.load(std::memory_order_relaxed) == 0;
+            begin = now();
+        }
+        TRACE_PROBE(phase__begin, static_cast<int>(phase), current_line.number);
+    }
+
+    ~Span() {
+        TRACE_PROBE(phase__end, static_cast<int>(phase), current_line.number);
+        if (on) {
+            record(phase, begin, now());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    Phase         phase;
+    bool          on;
+    std::uint64_t begin = 0;
+};
+
+/// Sets the line evaluated by the calling thread for the lifetime of the
+/// object, and records it as a "line" span. The spans inside it carry its
+/// number, length and depth. The number and length are set even while
+/// tracing is off, for the USDT probes, the depth only while it is on.
+class LineScope {
+public:
+    /// @param number Number of the line, from 1.
+    /// @param text The line.
+    LineScope(std::uint64_t number, const std::string& text)
+        : saved(current_line), on(active()) {
+        TRACE_PROBE(line__begin, number, text.size());
+        current_line = Line{number, text.size(), 0};
+        if (on) {
+            current_line.depth = max_depth(text);
+            start = mark();
+            begin = now();
+        }
+    }
+
+    /// For a line that is not held in memory, its length and depth are 0.
+    /// @param number Number of the line, from 1.
+    explicit LineScope(std::uint64_t number) : saved(current_line), on(active()) {
+        TRACE_PROBE(line__begin, number, 0);
+        current_line = Line{number, 0, 0};
+        if (on) {
+            start = mark();
+            begin = now();
+        }
+    }
+
+    ~LineScope() {
+        TRACE_PROBE(line__end, current_line.number, current_line.length);
+        if (on) {
+            std::uint64_t end = now();
+            if (end - begin < min_line_ns.load(std::memory_order_relaxed)) {
+                rollback(start);
+            } else {
+                record(LINE, begin, end);
+            }
+        }
+        current_line = saved;
+    }
+
+    /// Drops the line and its spans, for a line that turned out not to exist.
+    void cancel() {
+        if (on) {
+            rollback(start);
+            on = false;
+        }
+    }
+
+    LineScope(const LineScope&) = delete;
+    LineScope& operator=(const LineScope&) = delete;
+
+private:
+    Line          saved;
+    bool          on;
+    Mark          start{nullptr, 0};
+    std::uint64_t begin = 0;
+};
+
+/// Drops every recorded event. No thread may be recording.
+inline void reset() {
+    for (Buffer* b = buffers_head.load(); b != nullptr; b = b->next) {
+        b->current = b->first;
+        if (b->first != nullptr) {
+            b->first->used = 0;
+        }
+    }
+}
+
+/// Writes the recorded events as a Chrome trace event JSON document. The
+/// threads that recorded them must have finished or be idle.
+/// @param os Stream to write to.
+inline void write(std::ostream& os) {
+    long pid = static_cast<long>(::getpid());
+    char text[320];
+
+    std::snprintf(text, sizeof text,
+                  "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+                  "\"tid\":0,\"args\":{\"name\":\"postfix_calc\"}}", pid);
+    os << text;
+
+    for (Buffer* b = buffers_head.load(std::memory_order_acquire); b != nullptr; b = b->next) {
+        for (Block* block = b->first; block != nullptr; block = block->next) {
+            for (std::size_t i = 0; i < block->used; ++i) {
+                const Event& e = block->events[i];
+                std::uint64_t duration = e.end - e.begin;
+                int size = std::snprintf(
+                    text, sizeof text,
+                    ",\n{\"name\":\"%s\",\"cat\":\"postfix_calc\",\"ph\":\"X\",\"ts\":%llu.%03u,"
+                    "\"dur\":%llu.%03u,\"pid\":%ld,\"tid\":%u,\"args\":{\"line\":%llu,"
+                    "\"length\":%llu,\"depth\":%u}}",
+                    phase_names[e.phase],
+                    static_cast<unsigned long long>(e.begin / 1000), static_cast<unsigned>(e.begin % 1000),
+                    static_cast<unsigned long long>(duration / 1000), static_cast<unsigned>(duration % 1000),
+                    pid, static_cast<unsigned>(e.tid), static_cast<unsigned long long>(e.line),
+                    static_cast<unsigned long long>(e.length), static_cast<unsigned>(e.depth));
+                os.write(text, size);
+            }
+            if (block == b->current) {
+                break;  // later blocks are spare
+            }
+        }
+    }
+
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+} // namespace trace
+
+#endif // TRACE_HPP